@@ -0,0 +1,395 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+
+#include "fp_fmt.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
+
+// ---------------- batch runner ---------------- //
+// Job spec (text, one key per line, '#' - comment):
+//   input   capture.dat		int16 {re, im} pairs, raw little-endian
+//   output  run1			prefix: run1_sNN.dat / run1_sNN.idx per shard, run1.idx
+//   nfft    1024 4096		NFFT list
+//   scale   0x1C 0x1A -1	SCALE list, -1 - auto scale (BFP) per frame
+//   dir     c				'f' - FFT, 'i' - IFFT, 'c' - FFT + IFFT (as main)
+//   twiddle r				'r' - int16 ROM, 'f' - files (_PATH)
+//   workers 8				processes
+//   cache   rcache			result cache directory (optional): cached frames are not calculated
+// Items: frames of each NFFT (n_samples / NFFT, no overlap), each worker takes one
+// contiguous range of items; every frame is calculated once and written for each scale.
+// Outputs: int16 {re, im}, natural order.
+// Workers are fork()ed processes on POSIX (see fp_conv.cpp for the build), Win32 build runs
+// the shards one after another in the same process.
+
+int Batch_Load(const char* fname, BatchJob* job)
+{
+	memset(job, 0, sizeof(BatchJob));
+	job->_inv = 'c';
+	job->_tw = 'r';
+	job->workers = 1;
+
+	FILE* FJB = fopen(fname, "rt");
+	if (FJB == NULL)
+	{
+		printf("Cannot open job spec %s\n", fname);
+		return -1;
+	}
+	char line[512];
+	while (fgets(line, sizeof(line), FJB) != NULL)
+	{
+		char* cmt = strchr(line, '#');
+		if (cmt != NULL)
+			*cmt = 0;
+		char* key = strtok(line, " \t\r\n");
+		if (key == NULL)
+			continue;
+		char* val = strtok(NULL, " \t\r\n");
+		if (val == NULL)
+			continue;
+
+		if (strcmp(key, "input") == 0)
+			strncpy(job->input, val, sizeof(job->input) - 1);
+		else if (strcmp(key, "output") == 0)
+			strncpy(job->output, val, sizeof(job->output) - 1);
+		else if (strcmp(key, "dir") == 0)
+			job->_inv = val[0];
+		else if (strcmp(key, "twiddle") == 0)
+			job->_tw = val[0];
+		else if (strcmp(key, "workers") == 0)
+			job->workers = atoi(val);
+		else if (strcmp(key, "cache") == 0)
+			strncpy(job->cache, val, sizeof(job->cache) - 1);
+		else if ((strcmp(key, "nfft") == 0) || (strcmp(key, "scale") == 0))
+		{
+			int* lst = (key[0] == 'n') ? job->nfft : job->scale;
+			int* num = (key[0] == 'n') ? &job->n_nfft : &job->n_scale;
+			for (; (val != NULL) && (*num < BATCH_MAXCFG); val = strtok(NULL, " \t\r\n"))
+				lst[(*num)++] = (int)strtol(val, NULL, 0);
+		}
+		else
+			printf("Job spec: unknown key %s\n", key);
+	}
+	fclose(FJB);
+
+	if (job->n_scale == 0)
+		job->scale[job->n_scale++] = SCALE;
+	if ((job->input[0] == 0) || (job->output[0] == 0) || (job->n_nfft == 0))
+	{
+		printf("Job spec: input, output and nfft are required\n");
+		return -1;
+	}
+	for (int ii = 0; ii < job->n_nfft; ii++)
+	{
+		int nn = job->nfft[ii];
+		if ((nn < 8) || (nn > 262144) || (nn & (nn - 1)))
+		{
+			printf("Job spec: NFFT %d is not a power of 2 (8..262144)\n", nn);
+			return -1;
+		}
+	}
+	if ((job->_inv != 'f') && (job->_inv != 'i') && (job->_inv != 'c'))
+	{
+		printf("Job spec: dir must be f, i or c\n");
+		return -1;
+	}
+	if (job->workers < 1)
+		job->workers = 1;
+	return 0;
+}
+
+// ---------------- shared read-only input ---------------- //
+struct BatchMap
+{
+	const short* data;
+	long long n_bytes;
+#if defined(_WIN32)
+	HANDLE hfile;
+	HANDLE hmap;
+#else
+	int fd;
+#endif
+};
+
+static int Batch_Map(const char* fname, BatchMap* map)
+{
+	map->data = NULL;
+	map->n_bytes = 0;
+#if defined(_WIN32)
+	map->hmap = NULL;
+	map->hfile = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (map->hfile == INVALID_HANDLE_VALUE)
+		return -1;
+	LARGE_INTEGER size;
+	GetFileSizeEx(map->hfile, &size);
+	map->n_bytes = size.QuadPart;
+	map->hmap = CreateFileMappingA(map->hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map->hmap == NULL)
+		return -1;
+	map->data = (const short*)MapViewOfFile(map->hmap, FILE_MAP_READ, 0, 0, 0);
+#else
+	map->fd = open(fname, O_RDONLY);
+	if (map->fd < 0)
+		return -1;
+	struct stat st;
+	fstat(map->fd, &st);
+	map->n_bytes = st.st_size;
+	if (map->n_bytes == 0)
+		return -1;
+	void* ptr = mmap(NULL, map->n_bytes, PROT_READ, MAP_SHARED, map->fd, 0);
+	if (ptr == MAP_FAILED)
+		return -1;
+	map->data = (const short*)ptr;
+#endif
+	return (map->data != NULL) ? 0 : -1;
+}
+
+static void Batch_Unmap(BatchMap* map)
+{
+#if defined(_WIN32)
+	if (map->data != NULL)
+		UnmapViewOfFile(map->data);
+	if (map->hmap != NULL)
+		CloseHandle(map->hmap);
+	if (map->hfile != INVALID_HANDLE_VALUE)
+		CloseHandle(map->hfile);
+#else
+	if (map->data != NULL)
+		munmap((void*)map->data, map->n_bytes);
+	if (map->fd >= 0)
+		close(map->fd);
+#endif
+	map->data = NULL;
+}
+
+// ---------------- one shard: items [it0, it1) ---------------- //
+template <class FP>
+static int Batch_Shard(const BatchJob* job, const short* _din, long long n_smp, int shard, long long it0, long long it1)
+{
+	char fname[300];
+	sprintf(fname, "%s_s%02d.dat", job->output, shard);
+	FILE* FDT = fopen(fname, "wb");
+	sprintf(fname, "%s_s%02d.idx", job->output, shard);
+	FILE* FIX = fopen(fname, "wt");
+	if ((FDT == NULL) || (FIX == NULL))
+	{
+		printf("Shard %d: cannot open output %s\n", shard, fname);
+		return 1;
+	}
+	fprintf(FIX, "# nfft scale dir frame offset scale_used cached\n");
+
+	long long base = 0;
+	long long offset = 0;
+	long long n_hit = 0;
+	long long n_frm_all = 0;
+	for (int nn = 0; nn < job->n_nfft; nn++)
+	{
+		int nFFT = job->nfft[nn];
+		long long n_frm = n_smp / nFFT;
+		if ((base + n_frm <= it0) || (base >= it1))
+		{
+			base += n_frm;
+			continue;
+		}
+
+		FftPlan _Pf = Plan_FFT<FP>(nFFT, 'f', job->_tw);
+		FftPlan _Pi = Plan_FFT<FP>(nFFT, 'i', job->_tw);
+		if ((_Pf.ww == NULL) || (_Pi.ww == NULL))
+		{
+			printf("Shard %d: no twiddles for NFFT %d\n", shard, nFFT);
+			Free_FFT(&_Pf);
+			Free_FFT(&_Pi);
+			fclose(FDT);
+			fclose(FIX);
+			return 1;
+		}
+		const FftPlan* _Pin = (job->_inv == 'i') ? &_Pi : &_Pf;
+		const FftPlan* _Pout = (job->_inv == 'f') ? &_Pf : &_Pi;
+
+		int* _din_re = (int*)malloc(nFFT * sizeof(int));
+		int* _din_im = (int*)malloc(nFFT * sizeof(int));
+		ComplexVarFltst* _CF = (ComplexVarFltst*)malloc(nFFT * sizeof(ComplexVarFltst));
+		ComplexInt* _T24 = (ComplexInt*)malloc(nFFT * sizeof(ComplexInt));
+		short* _O16 = (short*)malloc(job->n_scale * 2 * nFFT * sizeof(short));
+		int* _used = (int*)malloc(job->n_scale * sizeof(int));
+		unsigned long long* _key = (unsigned long long*)malloc(job->n_scale * sizeof(unsigned long long));
+
+		long long f0 = (it0 > base) ? (it0 - base) : 0;
+		long long f1 = (it1 - base < n_frm) ? (it1 - base) : n_frm;
+		for (long long ff = f0; ff < f1; ff++)
+		{
+			const short* Sx = _din + 2 * ff * nFFT;
+
+			// CACHE: frame is calculated if any scale is missed
+			int hit = 0;
+			if (job->cache[0] != 0)
+			{
+				unsigned long long h = Cache_Hash(CACHE_SEED, Sx, 2 * nFFT * (long long)sizeof(short));
+				hit = 1;
+				for (int ss = 0; ss < job->n_scale; ss++)
+				{
+					_key[ss] = Cache_Key<FP>(h, _Pin, 'n', job->scale[ss]);
+					if (job->_inv == 'c')
+						_key[ss] = Cache_Key<FP>(_key[ss], &_Pi, 'n', job->scale[ss]);
+					if (hit)
+						hit = (Cache_Get(job->cache, _key[ss], 's', _O16 + ss * 2 * nFFT, 2 * nFFT, &_used[ss]) == 0);
+				}
+			}
+
+			if (!hit)
+			{
+				for (int ii = 0; ii < nFFT; ii++)
+				{
+					_din_re[ii] = Sx[2*ii+0];
+					_din_im[ii] = Sx[2*ii+1];
+				}
+				FLOAT_INPUT<FP>(_Pin, _din_re, _din_im, NULL, _CF);
+				int _exmax = FLOAT_FFT<FP>(_Pin, _CF);
+				if (job->_inv == 'c')
+					_exmax = FLOAT_FFT<FP>(&_Pi, _CF);
+				FftView _Out = View_FFT(_Pout, _CF, 'n');
+
+				for (int ss = 0; ss < job->n_scale; ss++)
+				{
+					_used[ss] = job->scale[ss];
+					if (_used[ss] < 0)
+						FLOAT_OUTPUT<FP>(&_Out, _exmax, 0, _T24, &_used[ss]);
+					else
+					{
+						for (int ii = 0; ii < nFFT; ii++)
+						{
+							_T24[ii].re = FP::float2fix(FP::collapse(_Out[ii].re), _used[ss]);
+							_T24[ii].im = FP::float2fix(FP::collapse(_Out[ii].im), _used[ss]);
+						}
+					}
+					short* Ox = _O16 + ss * 2 * nFFT;
+					for (int ii = 0; ii < nFFT; ii++)
+					{
+						Ox[2*ii+0] = (short)_T24[ii].re;
+						Ox[2*ii+1] = (short)_T24[ii].im;
+					}
+					if (job->cache[0] != 0)
+						Cache_Put(job->cache, _key[ss], 's', Ox, 2 * nFFT, _used[ss]);
+				}
+			}
+			n_hit += hit;
+			n_frm_all++;
+
+			// OUTPUT: one frame for each scale
+			for (int ss = 0; ss < job->n_scale; ss++)
+			{
+				fwrite(_O16 + ss * 2 * nFFT, sizeof(short), 2 * nFFT, FDT);
+				fprintf(FIX, "%d %d %c %lld %lld %d %d\n", nFFT, job->scale[ss], job->_inv, ff, offset, _used[ss], hit);
+				offset += 2 * nFFT * (long long)sizeof(short);
+			}
+		}
+		base += n_frm;
+
+		free(_din_re);
+		free(_din_im);
+		free(_CF);
+		free(_T24);
+		free(_O16);
+		free(_used);
+		free(_key);
+		Free_FFT(&_Pf);
+		Free_FFT(&_Pi);
+	}
+	fclose(FDT);
+	fclose(FIX);
+	if (job->cache[0] != 0)
+		printf("Shard %d: %lld of %lld frames from cache\n", shard, n_hit, n_frm_all);
+	return 0;
+}
+
+template <class FP>
+int Batch_Run(const BatchJob* job)
+{
+	BatchMap map;
+	if (Batch_Map(job->input, &map) != 0)
+	{
+		printf("Cannot map input %s\n", job->input);
+		Batch_Unmap(&map);
+		return -1;
+	}
+	long long n_smp = map.n_bytes / (2 * sizeof(short));
+
+	long long n_items = 0;
+	for (int nn = 0; nn < job->n_nfft; nn++)
+		n_items += n_smp / job->nfft[nn];
+	int n_wrk = job->workers;
+	if (n_wrk > n_items)
+		n_wrk = (n_items > 0) ? (int)n_items : 1;
+	printf("Batch: %lld samples, %lld frames, %d scales, %d workers\n", n_smp, n_items, job->n_scale, n_wrk);
+
+	int* status = (int*)malloc(n_wrk * sizeof(int));
+#if defined(_WIN32)
+	// no fork: shards one after another in this process
+	for (int ww = 0; ww < n_wrk; ww++)
+		status[ww] = Batch_Shard<FP>(job, map.data, n_smp, ww, n_items * ww / n_wrk, n_items * (ww + 1) / n_wrk);
+#else
+	// WORKERS: one process per shard, input pages are shared (read-only mapping)
+	fflush(stdout);
+	pid_t* pid = (pid_t*)malloc(n_wrk * sizeof(pid_t));
+	for (int ww = 0; ww < n_wrk; ww++)
+	{
+		pid[ww] = fork();
+		if (pid[ww] == 0)
+		{
+			int rc = Batch_Shard<FP>(job, map.data, n_smp, ww, n_items * ww / n_wrk, n_items * (ww + 1) / n_wrk);
+			fflush(stdout);
+			_exit(rc);
+		}
+		if (pid[ww] < 0)
+			status[ww] = Batch_Shard<FP>(job, map.data, n_smp, ww, n_items * ww / n_wrk, n_items * (ww + 1) / n_wrk);
+	}
+	for (int ww = 0; ww < n_wrk; ww++)
+	{
+		if (pid[ww] < 0)
+			continue;
+		int wst = 0;
+		waitpid(pid[ww], &wst, 0);
+		// exit code of shard, crashed worker: 128 + signal
+		status[ww] = WIFEXITED(wst) ? WEXITSTATUS(wst) : (128 + (WIFSIGNALED(wst) ? WTERMSIG(wst) : 0));
+	}
+	free(pid);
+#endif
+
+	// INDEX: shards in item order, merge = concatenation of *_sNN.dat
+	char fname[300];
+	sprintf(fname, "%s.idx", job->output);
+	FILE* FIX = fopen(fname, "wt");
+	int n_bad = 0;
+	if (FIX != NULL)
+		fprintf(FIX, "# shard data index item0 item1 status\n");
+	for (int ww = 0; ww < n_wrk; ww++)
+	{
+		if (FIX != NULL)
+			fprintf(FIX, "%d %s_s%02d.dat %s_s%02d.idx %lld %lld %d\n", ww, job->output, ww, job->output, ww,
+				n_items * ww / n_wrk, n_items * (ww + 1) / n_wrk, status[ww]);
+		if (status[ww] != 0)
+		{
+			printf("Batch: shard %d failed (status %d)\n", ww, status[ww]);
+			n_bad++;
+		}
+	}
+	if (FIX != NULL)
+		fclose(FIX);
+
+	free(status);
+	Batch_Unmap(&map);
+	return n_bad;
+}
+
+#define INST_BATCH(FP) \
+	template int Batch_Run<FP>(const BatchJob* job);
+FP_FORMATS(INST_BATCH)
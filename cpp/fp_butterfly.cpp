@@ -2,10 +2,11 @@
 #include "stdafx.h"
 #include <stdio.h>
 #include <math.h>
-#include "fp_op.h"
+#include "fp_fmt.h"
 #include <cstdlib>
 #include <cstring>
 
+template <class FP>
 void ButterflyFP (ComplexVarFltst *FA, ComplexVarFltst *FB, ComplexVarFltst *FcoeArr, int aa, int bb, int ww, int stage, char decim, int _use)
 {
 	// LOAD DATA IN
@@ -23,45 +24,37 @@ void ButterflyFP (ComplexVarFltst *FA, ComplexVarFltst *FB, ComplexVarFltst *Fco
 			VarFltst AB_RE;	VarFltst AB_IM;
 			VarFltst ABW_RE; VarFltst ABW_IM;		
 			VarFltst ABW_RE2; VarFltst ABW_IM2;	
-			// X = A+B	
-			X_RE = float_add23(A_RE, B_RE, 'a');
-			X_IM = float_add23(A_IM, B_IM, 'a');
+			// X = A+B, Y = (A-B)*W
+			FP::addsub(A_RE, B_RE, &X_RE, &AB_RE);
+			FP::addsub(A_IM, B_IM, &X_IM, &AB_IM);
 
-			// Y = (A-B)*W
-			AB_RE = float_add23(A_RE, B_RE, 's');
-			AB_IM = float_add23(A_IM, B_IM, 's');		
+			ABW_RE = FP::mult(AB_RE, W_RE);
+			ABW_IM = FP::mult(AB_IM, W_IM);
 
-			ABW_RE = float_mult23(AB_RE, W_RE);
-			ABW_IM = float_mult23(AB_IM, W_IM);
+			ABW_RE2 = FP::mult(AB_RE, W_IM);
+			ABW_IM2 = FP::mult(AB_IM, W_RE);
 
-			ABW_RE2 = float_mult23(AB_RE, W_IM);
-			ABW_IM2 = float_mult23(AB_IM, W_RE);
-
-			Y_RE = float_add23(ABW_RE, ABW_IM, 's');	
-			Y_IM = float_add23(ABW_RE2, ABW_IM2, 'a');	
+			Y_RE = FP::add(ABW_RE, ABW_IM, 's');	
+			Y_IM = FP::add(ABW_RE2, ABW_IM2, 'a');	
 		}
 		else if (decim == 't') // Decimation in time
 		{
 			VarFltst BW_RE; VarFltst BW_IM;	
 			VarFltst ABW_RE; VarFltst ABW_IM;	
 
-			BW_RE = float_mult23(B_RE, W_RE);
-			BW_IM = float_mult23(B_IM, W_IM);
-			/*ABW_RE = float_add23(BW_RE, BW_IM, 's');*/
-			ABW_RE = float_add23(BW_RE, BW_IM, 'a');
+			BW_RE = FP::mult(B_RE, W_RE);
+			BW_IM = FP::mult(B_IM, W_IM);
+			/*ABW_RE = FP::add(BW_RE, BW_IM, 's');*/
+			ABW_RE = FP::add(BW_RE, BW_IM, 'a');
 
-			BW_RE = float_mult23(B_RE, W_IM);
-			BW_IM = float_mult23(B_IM, W_RE);
-			/*ABW_IM = float_add23(BW_RE, BW_IM, 'a');*/
-			ABW_IM = float_add23(BW_IM, BW_RE, 's');
+			BW_RE = FP::mult(B_RE, W_IM);
+			BW_IM = FP::mult(B_IM, W_RE);
+			/*ABW_IM = FP::add(BW_RE, BW_IM, 'a');*/
+			ABW_IM = FP::add(BW_IM, BW_RE, 's');
 			
-			// X = A + B*W
-			X_RE = float_add23(A_RE, ABW_RE, 'a');
-			X_IM = float_add23(A_IM, ABW_IM, 'a');
-
-			// Y = A - B*W
-			Y_RE = float_add23(A_RE, ABW_RE, 's');
-			Y_IM = float_add23(A_IM, ABW_IM, 's');
+			// X = A + B*W, Y = A - B*W
+			FP::addsub(A_RE, ABW_RE, &X_RE, &Y_RE);
+			FP::addsub(A_IM, ABW_IM, &X_IM, &Y_IM);
 		}
 		// SAVE DATA OUT
 		FA[aa].re = X_RE;	FA[aa].im = X_IM; // You can get normal FFT-iFFT if IM part would be negative !!
@@ -76,13 +69,77 @@ void ButterflyFP (ComplexVarFltst *FA, ComplexVarFltst *FB, ComplexVarFltst *Fco
 	}
 }
 
-void Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs)
+// A+0, A-0 (_za = 0) or 0+A, 0-A (_za = 1) as FP::addsub with zero operand {0, 0, 0}:
+// for A.ex >= 0 there is no swap in A+0 and one add gives both results
+template <class FP>
+static inline void AddSub_Zero(VarFltst _aa, int _za, VarFltst* _sum, VarFltst* _dif)
+{
+	VarFltst ZZ = {0, 0, 0};
+	if (_aa.ex < 0)
+	{
+		if (_za)
+			FP::addsub(ZZ, _aa, _sum, _dif);
+		else
+			FP::addsub(_aa, ZZ, _sum, _dif);
+		return;
+	}
+	if (_za && (_aa.ex == 0) && (_aa.man == 0))
+	{
+		*_sum = ZZ;
+		*_dif = ZZ;
+		return;
+	}
+	*_sum = FP::add(_aa, ZZ, 'a');
+	*_dif = *_sum;
+	if (_za)
+		_dif->sig ^= 0x1;
+}
+
+// Butterfly with one zero input (input-pruned FFT): code BF_ZB - B = 0, BF_ZA - A = 0.
+// Same results as ButterflyFP: mult by zero gives {0, 0, 0}, add / sub with zero - AddSub_Zero
+template <class FP>
+void ButterflyZ(ComplexVarFltst *FA, const ComplexVarFltst *WW, int aa, int bb, int code, char decim)
 {
-	int x_stages = _log2(_nFFT / 2);
+	ComplexVarFltst XX, YY, DD;
+	if (decim == 'f')
+	{
+		// X = A+B, Y = (A-B)*W
+		ComplexVarFltst NZ = (code == BF_ZB) ? FA[aa] : FA[bb];
+		AddSub_Zero<FP>(NZ.re, (code == BF_ZA), &XX.re, &DD.re);
+		AddSub_Zero<FP>(NZ.im, (code == BF_ZA), &XX.im, &DD.im);
+
+		YY.re = FP::add(FP::mult(DD.re, WW->re), FP::mult(DD.im, WW->im), 's');
+		YY.im = FP::add(FP::mult(DD.re, WW->im), FP::mult(DD.im, WW->re), 'a');
+	}
+	else
+	{
+		// X = A + B*W, Y = A - B*W: B = 0 - B*W = 0, A = 0 - 0 + B*W, 0 - B*W
+		if (code == BF_ZB)
+		{
+			DD = FA[aa];
+		}
+		else
+		{
+			ComplexVarFltst BB = FA[bb];
+			DD.re = FP::add(FP::mult(BB.re, WW->re), FP::mult(BB.im, WW->im), 'a');
+			DD.im = FP::add(FP::mult(BB.im, WW->re), FP::mult(BB.re, WW->im), 's');
+		}
+		AddSub_Zero<FP>(DD.re, (code == BF_ZA), &XX.re, &YY.re);
+		AddSub_Zero<FP>(DD.im, (code == BF_ZA), &XX.im, &YY.im);
+	}
+	FA[aa] = XX;
+	FA[bb] = YY;
+}
+
+int Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs)
+{
+	int x_stages = 0;	// log2(_nFFT): fp23ww_<log2(NFFT)>.dat
+	while ((1 << x_stages) < _nFFT)
+		x_stages++;
 	VarFltst FPWR, FPWI;
 
 	char str[80];
-	char prev[80] = "H:\\Work\\_MATH\\twiddle\\fp23ww_";
+	char prev[80] = _PATH "twiddle\\fp23ww_";
 	char numb[80];
 	itoa(x_stages, numb, 10);
 
@@ -111,7 +168,7 @@ void Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs)
 	char numb_wr[80];
 	char last_wr[80] = ".dat";
 	itoa(x_stages, numb_wr, 10);
-	//char prev_wr[80] = "H:\\Work\\_MATH\\twiddle\\test_";
+	//char prev_wr[80] = _PATH "twiddle\\test_";
 
 	//strcpy(str_wr, "");
 	//strcat(str_wr, prev_wr);
@@ -120,10 +177,20 @@ void Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs)
 
 	FILE* FFRD = fopen(str, "r");
 	//FILE* FFWR = fopen(str_wr, "wt");
+	if (FFRD == NULL)
+	{
+		printf("Cannot open twiddle file %s\n", str);
+		return -1;
+	}
 	
 	for (int ii = 0; ii < _nFFT / 2; ii++)
 	{
-		fscanf(FFRD, "%d %d %d %d %d %d", &FPWR.ex, &FPWR.sig, &FPWR.man, &FPWI.ex, &FPWI.sig, &FPWI.man);
+		if (fscanf(FFRD, "%d %d %d %d %d %d", &FPWR.ex, &FPWR.sig, &FPWR.man, &FPWI.ex, &FPWI.sig, &FPWI.man) != 6)
+		{
+			printf("Twiddle file %s: %d of %d coeffs\n", str, ii, _nFFT / 2);
+			fclose(FFRD);
+			return -1;
+		}
 		//fprintf(FFWR, "%d %d %d %d %d %d\n", &FPWR.ex, &FPWR.sig, &FPWR.man, &FPWI.ex, &FPWI.sig, &FPWI.man);
 
 		CFPW[ii].re = FPWR;
@@ -131,4 +198,95 @@ void Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs)
 	}
 	fclose(FFRD);
 	//fclose(FFWR);
-}
\ No newline at end of file
+	return 0;
+}
+
+template <class FP>
+void Twiddle_ROM(int _nFFT, ComplexVarFltst* CFPW)
+{
+	// 1/4-periodic ROM as rom_twiddle_gen (int16 for fp23, FP::TW_BITS + 1 bits), 2nd quarter: {im, not re}
+	for (int ii = 0; ii < _nFFT / 2; ii++)
+	{
+		int kk = ii % (_nFFT / 4);
+		double phi = (kk * pi) / (_nFFT / 2);
+		int re_int = (int)floor(FP::TW_MAX * cos(phi) + 0.5);
+		int im_int = -(int)floor(FP::TW_MAX * sin(phi) + 0.5);
+
+		if (ii >= _nFFT / 4)
+		{
+			int tmp = re_int;
+			re_int = im_int;
+			im_int = ~tmp;
+		}
+		CFPW[ii].re = FP::expand(FP::coef2float(re_int));
+		CFPW[ii].im = FP::expand(FP::coef2float(im_int));
+	}
+}
+
+template <class FP>
+int Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs)
+{
+	(void)coefs;
+	Twiddle_ROM<FP>(_nFFT, CFPW);
+	return 0;
+}
+
+// fp23 uses twiddles from file (with Taylor scheme for large FFTs)
+template <>
+int Twiddle_WW<FpFmt23>(int _nFFT, ComplexVarFltst* CFPW, int coefs)
+{
+	return Twiddle_WW(_nFFT, CFPW, coefs);
+}
+
+// Packed twiddles {re, im}: 1/4-period if 2nd quarter is {im, -re}, else full N/2 table
+// _tw: 'f' - Twiddle_WW (file for fp23), 'r' - int16 ROM; NULL - no twiddle file
+template <class FP>
+ComplexInt* Twiddle_WQ(int _nFFT, int coefs, int* n_ww, char _tw)
+{
+	ComplexVarFltst* CFW = (ComplexVarFltst*)malloc((_nFFT/2)*sizeof(ComplexVarFltst));
+	ComplexInt* CFWQ = (ComplexInt*)malloc((_nFFT/2)*sizeof(ComplexInt));
+	if (_tw == 'r')
+		Twiddle_ROM<FP>(_nFFT, CFW);
+	else if (Twiddle_WW<FP>(_nFFT, CFW, coefs) != 0)
+	{
+		free(CFW);
+		free(CFWQ);
+		*n_ww = 0;
+		return NULL;
+	}
+
+	for (int ii = 0; ii < _nFFT / 2; ii++)
+	{
+		CFWQ[ii].re = FP::collapse(CFW[ii].re);
+		CFWQ[ii].im = FP::collapse(CFW[ii].im);
+	}
+	free(CFW);
+
+	int _sign = (int)(1u << (FP::EXP + FP::MAN));
+	*n_ww = _nFFT / 4;
+	for (int ii = 0; ii < _nFFT / 4; ii++)
+	{
+		if ((CFWQ[ii + _nFFT/4].re != CFWQ[ii].im) || (CFWQ[ii + _nFFT/4].im != (CFWQ[ii].re ^ _sign)))
+		{
+			printf("Twiddles are not 1/4-periodic, use full table!\n");
+			*n_ww = _nFFT / 2;
+			break;
+		}
+	}
+	if (*n_ww != _nFFT / 2)
+		CFWQ = (ComplexInt*)realloc(CFWQ, (*n_ww)*sizeof(ComplexInt));
+	return CFWQ;
+}
+
+void ButterflyFP(ComplexVarFltst *FA, ComplexVarFltst *FB, ComplexVarFltst *FcoeArr, int aa, int bb, int ww, int stage, char decim, int _use)
+{
+	ButterflyFP<FpFmt23>(FA, FB, FcoeArr, aa, bb, ww, stage, decim, _use);
+}
+
+#define INST_BFLY(FP) \
+	template void ButterflyFP<FP>(ComplexVarFltst *FA, ComplexVarFltst *FB, ComplexVarFltst *FcoeArr, int aa, int bb, int ww, int stage, char decim, int _use); \
+	template void ButterflyZ<FP>(ComplexVarFltst *FA, const ComplexVarFltst *WW, int aa, int bb, int code, char decim); \
+	template void Twiddle_ROM<FP>(int _nFFT, ComplexVarFltst* CFPW); \
+	template int Twiddle_WW<FP>(int _nFFT, ComplexVarFltst* CFPW, int coefs); \
+	template ComplexInt* Twiddle_WQ<FP>(int _nFFT, int coefs, int* n_ww, char _tw);
+FP_FORMATS(INST_BFLY)
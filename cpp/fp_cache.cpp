@@ -0,0 +1,121 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+
+#include "fp_fmt.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#define cache_pid() _getpid()
+#define cache_inc(x) InterlockedIncrement(x)
+#else
+#include <unistd.h>
+#define cache_pid() getpid()
+#define cache_inc(x) __sync_add_and_fetch(x, 1)
+#endif
+
+// ---------------- result cache ---------------- //
+// Key: FNV-1a 64 over input words, twiddle table and every setting which changes output bits.
+// File is written to <key>.<pid>_<seq>.tmp and renamed: readers (other workers,
+// other runs) see complete files only. Damaged / foreign files are misses.
+// seq: per process, atomic - every call has its own temporary file (threads of
+// OpenMP teams, Python threads without GIL).
+
+#define FNV_PRIME 0x100000001B3ULL
+
+static volatile long cache_seq = 0;
+
+unsigned long long Cache_Hash(unsigned long long h, const void* data, long long n_bytes)
+{
+	const unsigned char* Dx = (const unsigned char*)data;
+	for (long long ii = 0; ii < n_bytes; ii++)
+	{
+		h ^= Dx[ii];
+		h *= FNV_PRIME;
+	}
+	return h;
+}
+
+template <class FP>
+unsigned long long Cache_Key(unsigned long long h, const FftPlan* plan, char _nat, int _scale)
+{
+	int cfg[11] = {FP_MODEL, FP::EXP, FP::MAN, plan->n_fft, plan->_inv, _nat, _scale, plan->_tw, plan->_rdx, plan->z0, plan->z1};
+	h = Cache_Hash(h, cfg, sizeof(cfg));
+	// twiddle values: file tables (_Tay, regenerated files) differ with same _tw
+	h = Cache_Hash(h, plan->ww, plan->n_ww * (long long)sizeof(ComplexInt));
+	if (plan->bfly != NULL)
+		h = Cache_Hash(h, plan->bfly, plan->stages * (plan->n_fft / 2));
+	return h;
+}
+
+static int cache_size(char type)
+{
+	return (type == 's') ? 2 : 4;
+}
+
+static void cache_name(char* fname, const char* dir, unsigned long long key)
+{
+	sprintf(fname, "%s/%016llX.fpc", dir, key);
+}
+
+int Cache_Get(const char* dir, unsigned long long key, char type, void* data, int n_words, int* info)
+{
+	char fname[300];
+	cache_name(fname, dir, key);
+	FILE* FCH = fopen(fname, "rb");
+	if (FCH == NULL)
+		return -1;
+
+	// size first: short file does not touch data
+	fseek(FCH, 0, SEEK_END);
+	long n_bytes = ftell(FCH);
+	fseek(FCH, 0, SEEK_SET);
+	CacheHdr hdr;
+	int ok = (n_bytes == (long)(sizeof(CacheHdr) + (long)n_words * cache_size(type)));
+	ok = ok && (fread(&hdr, sizeof(CacheHdr), 1, FCH) == 1);
+	ok = ok && (memcmp(hdr.magic, "FPC1", 4) == 0) && (hdr.model == FP_MODEL) && (hdr.key == key);
+	ok = ok && (hdr.type == type) && (hdr.n_words == n_words);
+	ok = ok && (fread(data, cache_size(type), n_words, FCH) == (size_t)n_words);
+	fclose(FCH);
+	if (!ok)
+		return -1;
+	if (info != NULL)
+		*info = hdr.info;
+	return 0;
+}
+
+int Cache_Put(const char* dir, unsigned long long key, char type, const void* data, int n_words, int info)
+{
+	long seq = cache_inc(&cache_seq);
+	char fname[300], ftmp[320];
+	cache_name(fname, dir, key);
+	sprintf(ftmp, "%s.%d_%ld.tmp", fname, (int)cache_pid(), seq);
+
+	FILE* FCH = fopen(ftmp, "wb");
+	if (FCH == NULL)
+		return -1;
+	CacheHdr hdr;
+	memset(&hdr, 0, sizeof(CacheHdr));
+	memcpy(hdr.magic, "FPC1", 4);
+	hdr.model = FP_MODEL;
+	hdr.key = key;
+	hdr.type = type;
+	hdr.n_words = n_words;
+	hdr.info = info;
+	int ok = (fwrite(&hdr, sizeof(CacheHdr), 1, FCH) == 1);
+	ok = ok && (fwrite(data, cache_size(type), n_words, FCH) == (size_t)n_words);
+	ok = (fclose(FCH) == 0) && ok;
+	// Win32: no rename over existing file (same key from other worker), it is kept
+	if (!ok || (rename(ftmp, fname) != 0))
+	{
+		remove(ftmp);
+		return -1;
+	}
+	return 0;
+}
+
+#define INST_CACHE(FP) \
+	template unsigned long long Cache_Key<FP>(unsigned long long h, const FftPlan* plan, char _nat, int _scale);
+FP_FORMATS(INST_CACHE)
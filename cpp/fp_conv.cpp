@@ -1,79 +1,158 @@
 // fp_conv.cpp : Defines the entry point for the console application.
 
 #include <math.h>
+#if defined(_MSC_VER)
 #include <conio.h>
+#endif
 #include "stdafx.h"
 #include <cstdlib>
 
-#include "fp_op.h"
+#include "fp_fmt.h"
 #include <cstdlib>
 #include <cstring>
 
+typedef FpFormat<FP_EXP, FP_MAN> FpMain; // see FP_FORMATS
+
+// POSIX build (batch workers are processes): g++ -O2 -fopenmp -Ipython *.cpp -o fp_conv
+#if !defined(_MSC_VER)
+#define _tmain main
+typedef char _TCHAR;
+#endif
+
 int _tmain(int argc, _TCHAR* argv[])
 {
+	// BATCH: fp_conv <job spec>
+	if (argc > 1)
+	{
+		BatchJob _Job;
+		if (Batch_Load(argv[1], &_Job) != 0)
+			return -1;
+		return Batch_Run<FpMain>(&_Job);
+	}
+
+	if (_VRF == 1)
+	{
+		int n_bad = Verify_FP23<FpGeneric<6, 16> >(_VRF_STEP, 'a');
+		n_bad += Verify_FP23<FpFmt23>(_VRF_STEP, 's');
+		return n_bad;
+	}
+
 	// ---------------- LOAD DATA ---------------- //
-	char str_re[80] = "H:\\Work\\_MATH\\din_re.dat";
-	char str_im[80] = "H:\\Work\\_MATH\\din_im.dat";
+	char str_re[80] = _PATH "din_re.dat";
+	char str_im[80] = _PATH "din_im.dat";
 	FILE* FFRE = fopen(str_re, "r");
 	FILE* FFIM = fopen(str_im, "r");
 
-	int _xsin = 0;
-	int _xcos = 0;
-	VarFltst _sin, _cos;
+	if (_PROF == 1)
+		Prof_Open();
+
+	int* _din_re = (int*)malloc(N_FFT * sizeof(int));
+	int* _din_im = (int*)malloc(N_FFT * sizeof(int));
 	ComplexVarFltst* _CF = (ComplexVarFltst*)malloc(N_FFT * sizeof(ComplexVarFltst));
 
-	// ---------------- FIX2FLOAT ---------------- //
 	for (int ii = 0; ii < (N_FFT); ii++)
 	{
-			
-		fscanf(FFRE, "%d", &_xcos);
-		fscanf(FFIM, "%d", &_xsin);
-		{
-			int __sscos = fix2float23(_xcos);
-			int __sssin = fix2float23(_xsin);
-			_cos = float_expand23(__sscos);
-			_sin = float_expand23(__sssin);
-			
-			_CF[ii].re = _cos;
-			_CF[ii].im = _sin;
-		}
+		fscanf(FFRE, "%d", &_din_re[ii]);
+		fscanf(FFIM, "%d", &_din_im[ii]);
 	}
 	fclose(FFRE);
 	fclose(FFIM);
 
-	// ---------------- CALCULATE ---------------- //
-	int g_stages = _log2(N_FFT);
-	ComplexVarFltst* _Ax = (ComplexVarFltst*)malloc(N_FFT * sizeof(ComplexVarFltst));
-	ComplexVarFltst* _Bx = (ComplexVarFltst*)malloc(N_FFT * sizeof(ComplexVarFltst));
+	FftPlan _Pf = Plan_FFT<FpMain>(N_FFT, 'f');
+	FftPlan _Pi = Plan_FFT<FpMain>(N_FFT, 'i');
+	if ((_Pf.ww == NULL) || (_Pi.ww == NULL))
+	{
+		Free_FFT(&_Pf);
+		Free_FFT(&_Pi);
+		return -1;
+	}
+	_Pf.verbose = 1;
+	_Pi.verbose = 1;
+	if (_RDX == 4)
+	{
+		_Pf._rdx = '4';
+		_Pi._rdx = '4';
+	}
+
+	// ---------------- RESULT CACHE ---------------- //
+	ComplexInt* _T24 = (ComplexInt*)malloc(N_FFT * sizeof(ComplexInt));
+	int _scale = (_BFP == 1) ? -1 : SCALE;
+	unsigned long long _key = 0;
+	int _hit = -1;
+	if (_CACHE == 1)
+	{
+		double _wcfg[2] = {_WIN, _KAISER};
+		_key = Cache_Hash(CACHE_SEED, _din_re, N_FFT * sizeof(int));
+		_key = Cache_Hash(_key, _din_im, N_FFT * sizeof(int));
+		_key = Cache_Hash(_key, _wcfg, sizeof(_wcfg));
+		_key = Cache_Key<FpMain>(_key, &_Pf, 'n', _scale);
+		_key = Cache_Key<FpMain>(_key, &_Pi, 'n', _scale);
+		_hit = Cache_Get(_PATH "cache", _key, 'i', _T24, 2 * N_FFT, &_scale);
+		printf("Result cache %016llX: %s\n", _key, (_hit == 0) ? "hit" : "miss");
+	}
 
+	if (_hit != 0)
+	{
+		// ---------------- FIX2FLOAT + WINDOW ---------------- //
+		VarFltst* _W = NULL;
+		if (_WIN != 'r')
+		{
+			_W = (VarFltst*)malloc(N_FFT * sizeof(VarFltst));
+			Window_WW<FpMain>(N_FFT, _W, _WIN, _KAISER, NULL);
+		}
+		FLOAT_INPUT<FpMain>(&_Pf, _din_re, _din_im, _W, _CF);
 
+		// ---------------- FORWARD FFT ---------------- //
+		FftError _Err;
+		if (_RDX == 4)
+			Error_FFT<FpMain>(&_Pf, _CF, &_Err);
+		FLOAT_FFT<FpMain>(&_Pf, _CF);
+		// ---------------- INVERSE FFT ---------------- //
+		if (_RDX == 4)
+			Error_FFT<FpMain>(&_Pi, _CF, &_Err);
+		int _exmax = FLOAT_FFT<FpMain>(&_Pi, _CF);
+		// --------------------------------------------- //
+		FftView _Out = View_FFT(&_Pi, _CF, 'n');
 
-	// ---------------- FORWARD FFT ---------------- //
-	FLOAT_FFT(_CF, _Ax, _Bx, g_stages, 'r', 'f');
-	// ---------------- INVERSE FFT ---------------- //
-	FLOAT_FFT(_CF, _Ax, _Bx, g_stages, 'r', 'i');
-	// --------------------------------------------- //
-	
+		if (_BFP == 1)
+		{
+			_scale = SCALE;
+			FLOAT_OUTPUT<FpMain>(&_Out, _exmax, 0, _T24, &_scale);
+		}
+		else
+		{
+			for (int ii = 0; ii < N_FFT; ii++)
+			{
+				int _re, _im;
+				_re = FpMain::collapse(_Out[ii].re);
+				_im = FpMain::collapse(_Out[ii].im);
 
+				_re = FpMain::float2fix(_re, SCALE);
+				_im = FpMain::float2fix(_im, SCALE);
+				_T24[ii].re = _re;
+				_T24[ii].im = _im;
+			}
+		}
+		if (_CACHE == 1)
+			Cache_Put(_PATH "cache", _key, 'i', _T24, 2 * N_FFT, _scale);
+	}
 
 	// ---------------- OUTPUT DATA ---------------- //	
-	ComplexInt* _T24 = (ComplexInt*)malloc(N_FFT * sizeof(ComplexInt));
-	FILE* FTX = fopen("H:\\Work\\_MATH\\fp_cpp.dat", "wt");
+	if (_BFP == 1)
+		printf("Auto scale (BFP): 0x%02X\n", _scale);
+	FILE* FTX = fopen(_PATH "fp_cpp.dat", "wt");
 	for (int ii = 0; ii < N_FFT; ii++)
-	{
-		int Rev_ii = Reverse[ii];
-		int _re, _im;
-		
-		_re = float_collapse23(_CF[ii].re);
-		_im = float_collapse23(_CF[ii].im);
-
-		_re = float2fix23(_re, SCALE);
-		_im = float2fix23(_im, SCALE);
-		_T24[ii].re = _re;
-		_T24[ii].im = _im;
 		fprintf(FTX, "%d    %d\n", _T24[ii].re, _T24[ii].im);
-		//fprintf(FTX, "%d    %d    %d    \n", _T24[ii].re, _T24[ii].im, Rev_ii);
-	}
 	fclose(FTX);
 
+	Free_FFT(&_Pf);
+	Free_FFT(&_Pi);
+
+	if (_PROF == 1)
+	{
+		Prof_Dump(_PATH "fp_prof.json", 'j');
+		Prof_Dump(_PATH "fp_prof.csv", 'c');
+		Prof_Close();
+	}
+
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cstdlib>
+
+#include "fp_fmt.h"
+
+template <class FP>
+ComplexVarFltst FLOAT_CMULT(ComplexVarFltst _aa, ComplexVarFltst _bb)
+{
+	VarFltst ARE_BRE = FP::mult(_aa.re, _bb.re);
+	VarFltst AIM_BIM = FP::mult(_aa.im, _bb.im);
+	VarFltst ARE_BIM = FP::mult(_aa.re, _bb.im);
+	VarFltst AIM_BRE = FP::mult(_aa.im, _bb.re);
+
+	ComplexVarFltst CC;
+	CC.re = FP::add(ARE_BRE, AIM_BIM, 's');
+	CC.im = FP::add(ARE_BIM, AIM_BRE, 'a');
+	return CC;
+}
+
+template <class FP>
+int FLOAT_FCONV(const FftPlan* plan_f, const FftPlan* plan_i, ComplexVarFltst* _AF, const ComplexVarFltst* _SF)
+{
+	// FFT output is bit-reversed: IFFT input order, no reorder
+	FLOAT_FFT<FP>(plan_f, _AF);
+	for (int ii = 0; ii < plan_f->n_fft; ii++)
+		_AF[ii] = FLOAT_CMULT<FP>(_AF[ii], _SF[ii]);
+	return FLOAT_FFT<FP>(plan_i, _AF);
+}
+
+#define INST_FCONV(FP) \
+	template ComplexVarFltst FLOAT_CMULT<FP>(ComplexVarFltst _aa, ComplexVarFltst _bb); \
+	template int FLOAT_FCONV<FP>(const FftPlan* plan_f, const FftPlan* plan_i, ComplexVarFltst* _AF, const ComplexVarFltst* _SF);
+FP_FORMATS(INST_FCONV)
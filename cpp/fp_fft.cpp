@@ -3,34 +3,118 @@
 #include <math.h>
 #include <cstdlib>
 
-#include "fp_op.h" 
+#include "fp_fmt.h" 
 
-void FLOAT_FFT(ComplexVarFltst* _AF, ComplexVarFltst* _AR, ComplexVarFltst* _BR, int stages, char _nat, char _inv)
+// 1/4-period packed twiddles: {re, im} = {im, -re} of W[ww - N/4] for 2nd quarter
+template <class FP>
+static inline ComplexVarFltst Twiddle_Unpack(const ComplexInt* CFWQ, int n_ww, int ww)
 {
-	int stFFT = _log2(N_FFT);
-	
-	// TWIDDLE FACTOR: COE DATA
-	ComplexVarFltst* CFW = (ComplexVarFltst*)malloc(N_FFT*sizeof(ComplexVarFltst));
-	Twiddle_WW(N_FFT, CFW, _inv);
+	ComplexVarFltst W;
+	if (ww < n_ww)
+	{
+		W.re = FP::expand(CFWQ[ww].re);
+		W.im = FP::expand(CFWQ[ww].im);
+	}
+	else
+	{
+		W.re = FP::expand(CFWQ[ww - n_ww].im);
+		W.im = FP::expand(CFWQ[ww - n_ww].re);
+		W.im.sig ^= 0x1;
+	}
+	return W;
+}
 
-	// test only
-	ComplexVarFltst* Ax = (ComplexVarFltst*)malloc((N_FFT/2)*sizeof(ComplexVarFltst));
-	ComplexVarFltst* Bx = (ComplexVarFltst*)malloc((N_FFT/2)*sizeof(ComplexVarFltst));
-	ComplexVarFltst* Cx = (ComplexVarFltst*)malloc(N_FFT*sizeof(ComplexVarFltst));
+template <class FP>
+FftPlan Plan_FFT(int _nFFT, char _inv, char _tw)
+{
+	FftPlan plan;
+	plan.n_fft = _nFFT;
+	plan.stages = 0;
+	while ((1 << plan.stages) < _nFFT)
+		plan.stages++;
+	plan._inv = _inv;
+	plan._tw = _tw;
+	plan._rdx = '2';
+	plan.bfly = NULL;
+	plan.bout = NULL;
+	plan.z0 = 0;
+	plan.z1 = 0;
+	plan.verbose = 0;
 
-	for (int ii=0; ii<N_FFT; ii++)
+	// TWIDDLE FACTOR: COE DATA (1/4-period, packed)
+	PROF_BEGIN();
+	plan.ww = Twiddle_WQ<FP>(_nFFT, _inv, &plan.n_ww, _tw);
+	PROF_END("twiddle", 0);
+
+	plan.rev = (int*)malloc(_nFFT*sizeof(int));
+	for (int ii=0; ii<_nFFT; ii++)
+		plan.rev[ii] = reverse_nbit(ii, plan.stages);
+	return plan;
+}
+
+void Free_FFT(FftPlan* plan)
+{
+	free(plan->ww);
+	free(plan->rev);
+	free(plan->bfly);
+	free(plan->bout);
+	plan->ww = NULL;
+	plan->rev = NULL;
+	plan->bfly = NULL;
+	plan->bout = NULL;
+}
+
+FftView View_FFT(const FftPlan* plan, ComplexVarFltst* _AF, char ord)
+{
+	FftView view = {_AF, plan->n_fft, plan->_inv, ord, plan->rev};
+	return view;
+}
+
+// max exponent of butterfly outputs (last stage)
+template <class FP>
+static inline int Exp_Max(const ComplexVarFltst* Cx, int aa, int bb, int exmax)
+{
+	int ex[4] = {FP::exp_of(Cx[aa].re), FP::exp_of(Cx[aa].im), FP::exp_of(Cx[bb].re), FP::exp_of(Cx[bb].im)};
+	for (int kk=0; kk<4; kk++)
+		if (ex[kk] > exmax)
+			exmax = ex[kk];
+	return exmax;
+}
+
+template <class FP>
+int FLOAT_FFT(const FftPlan* plan, ComplexVarFltst* _AF)
+{
+	if ((plan->_rdx == '4') && (plan->bfly == NULL))
+		return FLOAT_FFT_R4<FP>(plan, _AF);
+
+	int nFFT = plan->n_fft;
+	int stFFT = 0;
+	while ((1 << stFFT) < nFFT)
+		stFFT++;
+	int stages = plan->stages;
+	int exmax = -1;
+	
+	// FFT/IFFT in place: _AF
+	ComplexVarFltst* Cx = _AF;
+	const unsigned char* Bx = plan->bfly;
+
+	// INPUT PRUNING: zero region is not converted / loaded, write zeros
+	VarFltst ZZ = {0, 0, 0};
+	for (int ii = plan->z0; ii < plan->z1; ii++)
 	{
-		Cx[ii].re = _AF[ii].re; 
-		Cx[ii].im = _AF[ii].im; 
+		int jj = (plan->_inv == 'f') ? ii : plan->rev[ii];
+		Cx[jj].re = ZZ;
+		Cx[jj].im = ZZ;
 	}
 
-	if (_inv == 'f')
+	if (plan->_inv == 'f')
 	{
-		printf("\n**** Forward FFT Calculation start! ****\n");
 		// **************************** FFT CALCULATE **************************** //
 		for (int cnt=1; cnt<stages+1; cnt++)
 		{
-			printf("Fwd FFT stage: 0x%02X\n", cnt);
+			if (plan->verbose)
+				printf("Fwd FFT stage: 0x%02X\n", cnt);
+			PROF_BEGIN();
 			
 			int CNT_ii = pow(2.0,(stFFT-cnt)); 
 			int CNT_jj = pow(2.0,(cnt-1));
@@ -40,36 +124,37 @@ void FLOAT_FFT(ComplexVarFltst* _AF, ComplexVarFltst* _AR, ComplexVarFltst* _BR,
 			{
 				for (int ii=0; ii<CNT_ii; ii++)
 				{
-					int jN = ii+jj*(N_FFT/pow(2.0,cnt-1));
-					int iN = N_FFT/(pow(2.0,cnt));
+					int code = (Bx != NULL) ? Bx[(cnt-1)*(nFFT/2) + counter] : BF_FULL;
+					if (code == BF_SKIP)
+					{
+						counter++;
+						continue;
+					}
+					int jN = ii+jj*(nFFT/pow(2.0,cnt-1));
+					int iN = nFFT/(pow(2.0,cnt));
 					//printf("%04X\t", ii);
 
-					int _var = jj*N_FFT/pow(2.0,cnt);
-
-					Ax[ii+_var].re = Cx[jN].re; 
-					Ax[ii+_var].im = Cx[jN].im;
-					Bx[ii+_var].re = Cx[jN+iN].re; 
-					Bx[ii+_var].im = Cx[jN+iN].im; 
-
-					ButterflyFP(Ax, Bx, CFW, ii+_var, ii+_var, ii*CNT_jj, cnt, 'f', 1);
-
-					Cx[jN].re = Ax[ii+_var].re; 
-					Cx[jN].im = Ax[ii+_var].im; 
-					Cx[jN+iN].re = Bx[ii+_var].re;
-					Cx[jN+iN].im = Bx[ii+_var].im;
+					ComplexVarFltst WW = Twiddle_Unpack<FP>(plan->ww, plan->n_ww, ii*CNT_jj);
+					if (code == BF_FULL)
+						ButterflyFP<FP>(Cx, Cx, &WW, jN, jN+iN, 0, cnt, 'f', 1);
+					else
+						ButterflyZ<FP>(Cx, &WW, jN, jN+iN, code, 'f');
+					if (cnt == stages)
+						exmax = Exp_Max<FP>(Cx, jN, jN+iN, exmax);
 					counter++;
 				}
 			}
+			PROF_END("fft_stage", cnt);
 		}
 	}
-	else if (_inv == 'i')
+	else if (plan->_inv == 'i')
 	{
-		printf("\n**** Inverse FFT Calculation start! ****\n");
 		// **************************** IFFT CALCULATE **************************** //
-		//for (int cnt=1; cnt<stages+1; cnt++)
 		for (int cnt = 1; cnt<stages +1; cnt++)
 		{
-			printf("Inv FFT stage: 0x%02X\n", cnt);
+			if (plan->verbose)
+				printf("Inv FFT stage: 0x%02X\n", cnt);
+			PROF_BEGIN();
 			int CNT_ii = pow(2.0,(cnt-1));
 			int CNT_jj = pow(2.0,(stFFT-cnt));	
 			int counter = 0x0;
@@ -77,97 +162,100 @@ void FLOAT_FFT(ComplexVarFltst* _AF, ComplexVarFltst* _AR, ComplexVarFltst* _BR,
 			{
 				for (int ii=0; ii<CNT_ii; ii++)
 				{
+					int code = (Bx != NULL) ? Bx[(cnt-1)*(nFFT/2) + counter] : BF_FULL;
+					if (code == BF_SKIP)
+					{
+						counter++;
+						continue;
+					}
 					int jN = ii+jj*(pow(2.0,cnt));
 					int iN = pow(2.0,cnt-1);
 					//printf("%04X\t", ii);
-					int _var = ii*N_FFT/pow(2.0,cnt);
-
-					Ax[jj+_var].re = Cx[jN].re; 
-					Ax[jj+_var].im = Cx[jN].im;
-					Bx[jj+_var].re = Cx[jN+iN].re; 
-					Bx[jj+_var].im = Cx[jN+iN].im; 
-
-					ButterflyFP(Ax, Bx, CFW, jj+_var, jj+_var, ii*CNT_jj, cnt, 't', 1);
-
-					Cx[jN].re = Ax[jj+_var].re; 
-					Cx[jN].im = Ax[jj+_var].im; 
-					Cx[jN+iN].re = Bx[jj+_var].re;
-					Cx[jN+iN].im = Bx[jj+_var].im;
+					ComplexVarFltst WW = Twiddle_Unpack<FP>(plan->ww, plan->n_ww, ii*CNT_jj);
+					if (code == BF_FULL)
+						ButterflyFP<FP>(Cx, Cx, &WW, jN, jN+iN, 0, cnt, 't', 1);
+					else
+						ButterflyZ<FP>(Cx, &WW, jN, jN+iN, code, 't');
+					if (cnt == stages)
+						exmax = Exp_Max<FP>(Cx, jN, jN+iN, exmax);
 					counter++;
 				}
 			}
+			PROF_END("ifft_stage", cnt);
 		}
 	}
 	else
 	{
 		printf("**** CANNOT CALCULATE FFT/IFFT (SET _INV to 'f' or 'i') ****\n\n");
 	}
+	return exmax;
+}
+
+template <class FP>
+void FLOAT_FFT(ComplexVarFltst* _AF, ComplexVarFltst* _AR, ComplexVarFltst* _BR, int stages, char _nat, char _inv)
+{
+	FftPlan plan = Plan_FFT<FP>(N_FFT, _inv);
+	plan.stages = stages;
+	plan.verbose = 1;
+
+	if (_inv == 'f')
+		printf("\n**** Forward FFT Calculation start! ****\n");
+	else if (_inv == 'i')
+		printf("\n**** Inverse FFT Calculation start! ****\n");
+	FLOAT_FFT<FP>(&plan, _AF);
 	printf("**** Calculation finish! ****\n\n");
-	
-	// BIT-REVERSE
-	VarFltst* Na_re = (VarFltst*)malloc((N_FFT/2)*sizeof(VarFltst));
-	VarFltst* Na_im = (VarFltst*)malloc((N_FFT/2)*sizeof(VarFltst));
-	VarFltst* Nb_re = (VarFltst*)malloc((N_FFT/2)*sizeof(VarFltst));
-	VarFltst* Nb_im = (VarFltst*)malloc((N_FFT/2)*sizeof(VarFltst));
-
-	fill_reverse(N_FFT);
-	for (int ii=0; ii<N_FFT/2; ii++)
+
+	// OUTPUT ORDER: 'r' - as calculated, 'n' - natural, 'v' - no copies, read _AF by FftView
+	PROF_BEGIN();
+	if (_nat == 'n')
 	{
-		if (_nat == 'n')
+		if (_inv == 'f')
 		{
-			int Rev_ii = Reverse[ii];
-			Na_re[ii] = Ax[Rev_ii].re;
-			Na_im[ii] = Ax[Rev_ii].im;
-			Nb_re[ii] = Bx[Rev_ii].re;
-			Nb_im[ii] = Bx[Rev_ii].im;
-		}
-		else if (_nat == 'r')
-		{
-			Na_re[ii] = Ax[ii].re;
-			Na_im[ii] = Ax[ii].im;
-			Nb_re[ii] = Bx[ii].re;
-			Nb_im[ii] = Bx[ii].im;
+			for (int ii=0; ii<N_FFT; ii++)
+			{
+				int Rev_ii = plan.rev[ii];
+				if (ii < Rev_ii)
+				{
+					ComplexVarFltst Tx = _AF[ii];
+					_AF[ii] = _AF[Rev_ii];
+					_AF[Rev_ii] = Tx;
+				}
+			}
 		}
-		else
+		for (int ii=0; ii<N_FFT/2; ii++)
 		{
-			printf("Incorrect variable /Reverse/ !!\n");
-			break;
+			_AR[ii] = _AF[ii];
+			_BR[ii] = _AF[ii+N_FFT/2];
 		}
 	}
-
-	for (int ii=0; ii<N_FFT/2; ii++)
-	{
-		_AR[ii].re = Na_re[ii];
-		_AR[ii].im = Na_im[ii];
-		_BR[ii].re = Nb_re[ii];
-		_BR[ii].im = Nb_im[ii];
-	}
-
-	if (_inv == 'f')
+	else if (_nat == 'r')
 	{
+		FftView va = View_FFT(&plan, _AF, 'a');
+		FftView vb = View_FFT(&plan, _AF, 'b');
 		for (int ii=0; ii<N_FFT/2; ii++)
 		{
-			_AF[2*ii].re = _AR[ii].re;
-			_AF[2*ii].im = _AR[ii].im;
-			_AF[2*ii+1].re = _BR[ii].re;
-			_AF[2*ii+1].im = _BR[ii].im;
+			_AR[ii] = va[ii];
+			_BR[ii] = vb[ii];
 		}
 	}
-	if (_inv == 'i')
+	else if (_nat != 'v')
 	{
-		for (int ii=0; ii<N_FFT/2; ii++)
-		{
-			_AF[ii].re = _AR[ii].re;
-			_AF[ii].im = _AR[ii].im;
-			_AF[ii+N_FFT/2].re = _BR[ii].re;
-			_AF[ii+N_FFT/2].im = _BR[ii].im;
-		}
+		printf("Incorrect variable /Reverse/ !!\n");
 	}
+	PROF_END("reorder", 0);
 
-	free(Na_re); free(Na_im);
-	free(Nb_re); free(Nb_im);
-	free(Ax); free(Bx); free(Cx);
-	free(CFW);
+	Free_FFT(&plan);
 
 	//printf("DONE FFT F24 NEW!!\n");
 }
+
+void FLOAT_FFT(ComplexVarFltst* _AF, ComplexVarFltst* _AR, ComplexVarFltst* _BR, int stages, char _nat, char _inv)
+{
+	FLOAT_FFT<FpFmt23>(_AF, _AR, _BR, stages, _nat, _inv);
+}
+
+#define INST_FFT(FP) \
+	template FftPlan Plan_FFT<FP>(int _nFFT, char _inv, char _tw); \
+	template int FLOAT_FFT<FP>(const FftPlan* plan, ComplexVarFltst* _AF); \
+	template void FLOAT_FFT<FP>(ComplexVarFltst* _AF, ComplexVarFltst* _AR, ComplexVarFltst* _BR, int stages, char _nat, char _inv);
+FP_FORMATS(INST_FFT)
@@ -0,0 +1,279 @@
+#ifndef FP_FMT_H
+#define FP_FMT_H
+
+#include "fp_op.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// ---------------- custom float format ---------------- //
+// Vector: [SIGN | EXP_BITS | MAN_BITS], hidden '1' for (exp != 0).
+// FpGeneric<> repeats fp23 operators bit by bit, all constants are taken
+// from the widths: FpGeneric<6, 16> gives the same results as fp23.
+// FpFormat<> is the type for FFT engine, FpFormat<6, 16> is specialized
+// to hand-written fp23 operators (fp_op.cpp).
+
+// ---------------- helpers ---------------- //
+template <int N> struct FpLog2Ceil { enum { value = 1 + FpLog2Ceil<(N + 1) / 2>::value }; };
+template <> struct FpLog2Ceil<1> { enum { value = 0 }; };
+
+// position of MSB for (_x != 0)
+static inline int fp_msb_pos(unsigned int _x)
+{
+#if defined(_MSC_VER)
+	unsigned long pos;
+	_BitScanReverse(&pos, _x);
+	return (int)pos;
+#else
+	return 31 - __builtin_clz(_x);
+#endif
+}
+
+template <int EXP_BITS, int MAN_BITS>
+struct FpGeneric
+{
+	enum {
+		EXP			= EXP_BITS,
+		MAN			= MAN_BITS,
+		WIDTH		= 1 + EXP_BITS + MAN_BITS,
+		MAN_MASK	= (1 << MAN_BITS) - 1,
+		EXP_MASK	= (1 << EXP_BITS) - 1,
+		IMP_BIT		= (1 << MAN_BITS),
+		FIX_BIAS	= (1 << (EXP_BITS - 2)),	// exponent of int16 '1': 0x10 for fp23
+		TW_BITS		= MAN_BITS - 1,				// ROM coeffs (twiddles, windows): signed, 1.0 = 2^TW_BITS
+		TW_MAX		= (1 << TW_BITS) - 1,		// 32767 for fp23
+		MLT_BIAS	= FIX_BIAS + TW_BITS,		// double -16 for Fourier: twiddles are int * 2^TW_BITS
+		DIF_LO		= (1 << FpLog2Ceil<MAN_BITS>::value) - 1,	// exponent difference: shift
+		DIF_HI		= EXP_MASK & ~DIF_LO					// exponent difference: zero mant
+	};
+
+	/*****************************************************************/
+	static int exp_of(VarFltst _fp)
+	{
+		return _fp.ex & EXP_MASK;
+	}
+	/*****************************************************************/
+	static VarFltst expand(int _fp)
+	{
+		VarFltst _fRes;
+		_fRes.man	= (_fp & MAN_MASK);
+		_fRes.sig	= (_fp >> (EXP + MAN)) & 0x1;
+		_fRes.ex	= (_fp >> MAN) & EXP_MASK;
+		return _fRes;
+	}
+	/*****************************************************************/
+	static int collapse(VarFltst fRes)
+	{
+		unsigned int _fp;
+		_fp = (((unsigned int)fRes.ex << MAN) & ((unsigned int)EXP_MASK << MAN))
+			+ (((unsigned int)fRes.sig << (EXP + MAN)) & (1u << (EXP + MAN)))
+			+ (unsigned int)(fRes.man);
+		return (int)_fp;
+	}
+	/*****************************************************************/
+	// _fix - sign-extended int16
+	static int fix2float(int _fix)
+	{
+		int sign_fp = (_fix >> 15) & 0x1;
+		int mant_fp = (sign_fp == 1) ? ~_fix : _fix;
+
+		int msb_fp = 0;
+		int man_fp = 0;
+		if (mant_fp != 0)
+		{
+			int lz = 15 - fp_msb_pos(mant_fp & 0xFFFF);
+			int frac = (mant_fp << (lz + 1)) & 0xFFFF;
+			msb_fp = FIX_BIAS + 15 - lz;
+			man_fp = (MAN >= 16) ? (frac << (MAN - 16)) : (frac >> (16 - MAN));
+		}
+		VarFltst fRes;
+		fRes.sig = sign_fp;
+		fRes.ex	 = msb_fp;
+		fRes.man = man_fp;
+		return collapse(fRes);
+	}
+	/*****************************************************************/
+	// _fix - ROM coefficient of (TW_BITS + 1) bits, int16 for fp23
+	static int coef2float(int _fix)
+	{
+		int sign_fp = (_fix < 0);
+		int mant_fp = (sign_fp == 1) ? ~_fix : _fix;
+
+		int msb_fp = 0;
+		int man_fp = 0;
+		if (mant_fp != 0)
+		{
+			int pos = fp_msb_pos(mant_fp);
+			int frac = mant_fp & ((1 << pos) - 1);
+			msb_fp = FIX_BIAS + pos;
+			man_fp = (pos <= MAN) ? (frac << (MAN - pos)) : (frac >> (pos - MAN));
+		}
+		VarFltst fRes;
+		fRes.sig = sign_fp;
+		fRes.ex	 = msb_fp;
+		fRes.man = man_fp;
+		return collapse(fRes);
+	}
+	/*****************************************************************/
+	// _scale - in fp23 units (SCALE), rebiased for other formats
+	static int float2fix(int _fp, int _scale)
+	{
+		VarFltst fRes = expand(_fp);
+
+		int zero = fRes.ex - _scale - (FIX_BIAS - 0x10);
+		int new_exp = zero & 0xF;
+
+		long long _mant = fRes.man;
+		if (fRes.ex != 0)
+			_mant |= IMP_BIT;
+
+		int mant_16 = (int)(((_mant << new_exp) >> MAN) & 0xFFFF);
+
+		int _FIX = (fRes.sig == 1) ? (-mant_16 - 1) : mant_16;
+
+		if ((zero & (EXP_MASK & ~0xF)) || ((zero & 0xF) == 0xF))
+			_FIX = (fRes.sig == 0) ? 0x7FFF : (-0x7FFF - 1);
+
+		if (zero < 0)
+			_FIX = 0x0000;
+
+		return _FIX;
+	}
+	/*****************************************************************/
+	static VarFltst mult(VarFltst _aa, VarFltst _bb)
+	{
+		VarFltst CC;
+		CC.sig = (_aa.sig ^ _bb.sig);
+
+		long long a1 = _aa.man | IMP_BIT;
+		long long a2 = _bb.man | IMP_BIT;
+		long long mant = a1 * a2;
+
+		int msb = (int)(mant >> (2 * MAN + 1)) & 0x1;
+		CC.man = (int)(mant >> (MAN + msb)) & MAN_MASK;
+		CC.ex  = (_aa.ex + _bb.ex - MLT_BIAS) + msb;
+
+		if ((_aa.ex == 0) | (_bb.ex == 0))
+		{
+			CC.ex = 0x0;
+			CC.man = 0x0;
+			CC.sig = 0x0;
+		}
+		return CC;
+	}
+	/*****************************************************************/
+	static VarFltst add(VarFltst _aa, VarFltst _bb, char addsub)
+	{
+		VarFltst AA = _aa;
+		VarFltst BB = _bb;
+		VarFltst CC;
+
+		if (addsub == 's')
+			BB.sig = (~BB.sig & 0x1);
+
+		long long Aexpman = (long long)AA.ex * IMP_BIT + AA.man;
+		long long Bexpman = (long long)BB.ex * IMP_BIT + BB.man;
+		if (Aexpman < Bexpman)
+		{
+			CC = AA; AA = BB; BB = CC;
+		}
+
+		if (AA.ex != 0)
+			AA.man |= IMP_BIT;
+		if (BB.ex != 0)
+			BB.man |= IMP_BIT;
+
+		int exp_dif = AA.ex - BB.ex;
+		int mant = BB.man >> (exp_dif & DIF_LO);
+		if (exp_dif & DIF_HI)
+			mant = 0x0;
+
+		long long sum_man;
+		if ((AA.sig ^ BB.sig) == 0)
+			sum_man = AA.man + mant;
+		else
+			sum_man = AA.man - mant;
+
+		return norm(AA.ex, AA.sig, sum_man);
+	}
+	/*****************************************************************/
+	// A+B and A-B with one compare, swap and alignment
+	static void addsub(VarFltst _aa, VarFltst _bb, VarFltst* _sum, VarFltst* _dif)
+	{
+		VarFltst AA = _aa;
+		VarFltst BB = _bb;
+
+		long long Aexpman = (long long)_aa.ex * IMP_BIT + _aa.man;
+		long long Bexpman = (long long)_bb.ex * IMP_BIT + _bb.man;
+		int swap = (Aexpman < Bexpman);
+		if (swap)
+		{
+			AA = _bb;
+			BB = _aa;
+		}
+
+		if (AA.ex != 0)
+			AA.man |= IMP_BIT;
+		if (BB.ex != 0)
+			BB.man |= IMP_BIT;
+
+		int exp_dif = AA.ex - BB.ex;
+		int mant = BB.man >> (exp_dif & DIF_LO);
+		if (exp_dif & DIF_HI)
+			mant = 0x0;
+
+		long long man_add = (long long)AA.man + mant;
+		long long man_sub = (long long)AA.man - mant;
+
+		int Csub = _aa.sig ^ _bb.sig;
+		int sig_add = swap ? _bb.sig : _aa.sig;
+		int sig_sub = swap ? (~_bb.sig & 0x1) : _aa.sig;
+
+		*_sum = norm(AA.ex, sig_add, (Csub == 0) ? man_add : man_sub);
+		*_dif = norm(AA.ex, sig_sub, (Csub == 0) ? man_sub : man_add);
+	}
+	/*****************************************************************/
+	// MSB SEEKER: window [MAN+1 : 2] of sum, no MSB - shift by (2*MAN-1)
+	static VarFltst norm(int _ex, int _sig, long long sum_man)
+	{
+		VarFltst CC;
+		int lead = (int)((sum_man >> 2) & MAN_MASK);
+		int msbn = (lead == 0) ? (2 * MAN - 1) : (MAN - 1 - fp_msb_pos(lead));
+
+		unsigned long long LUT = (unsigned long long)(sum_man >> 1) << msbn;
+
+		if ((_ex - msbn) < 0)
+			CC.ex = 0x0;
+		else
+			CC.ex = (_ex - msbn) + 1;
+		CC.sig = _sig;
+		CC.man = (int)(LUT & MAN_MASK);
+		return CC;
+	}
+};
+
+// ---------------- formats for FFT engine ---------------- //
+template <int EXP_BITS, int MAN_BITS>
+struct FpFormat : FpGeneric<EXP_BITS, MAN_BITS> {};
+
+template <>
+struct FpFormat<6, 16> : FpGeneric<6, 16>
+{
+	static VarFltst expand(int _fp) { return float_expand23(_fp); }
+	static int collapse(VarFltst fRes) { return float_collapse23(fRes); }
+	static int fix2float(int _fix) { return fix2float23(_fix); }
+	static int coef2float(int _fix) { return fix2float23(_fix); }
+	static int float2fix(int _fp, int _scale) { return float2fix23(_fp, _scale); }
+	static VarFltst mult(VarFltst _aa, VarFltst _bb) { return float_mult23(_aa, _bb); }
+	static VarFltst add(VarFltst _aa, VarFltst _bb, char addsub) { return float_add23(_aa, _bb, addsub); }
+	static void addsub(VarFltst _aa, VarFltst _bb, VarFltst* _sum, VarFltst* _dif) { float_addsub23(_aa, _bb, _sum, _dif); }
+};
+
+typedef FpFormat<6, 16> FpFmt23;	// fp23: 1 + 6 + 16
+typedef FpFormat<8, 18> FpFmt27;	// fp27: 1 + 8 + 18
+typedef FpFormat<8, 23> FpFmt32;	// fp32: 1 + 8 + 23
+
+// Formats compiled into FFT engine (explicit instantiations), add new widths here
+#define FP_FORMATS(_inst) _inst(FpFmt23) _inst(FpFmt27) _inst(FpFmt32)
+
+#endif
@@ -1,5 +1,5 @@
 #include <math.h>
-#include "fp_op.h"
+#include "fp_fmt.h"
 
 /*****************************************************************/
 int float_collapse23(VarFltst fRes)
@@ -91,45 +91,6 @@ int fix2float23(int _fix)
 	return FP;
 }
 /*****************************************************************/
-int fix2float32(int _fix)
-{
-	int msb = 1;
-	int sign_fp = (_fix >> 22) & 0x1;
-
-	int mant_fp = 0;
-	if (sign_fp == 1)
-		mant_fp = 0xFFFFFFFF ^ (_fix);
-	else
-		mant_fp = _fix;
-
-	for (int jj = 0; jj<24; jj++)
-	{
-		if (mant_fp == 0)
-		{
-			msb = 46;
-			break;
-		}
-		else
-		{
-			if (mant_fp & 0x800000)
-			{
-				mant_fp = mant_fp << 1;
-				break;
-			}
-			else
-			{
-				mant_fp = mant_fp << 1;
-				msb++;
-			}
-		}
-	}
-	int msb_fp = 32 - msb;
-	mant_fp &= 0xFFFF;
-	int FP = ((sign_fp << 30) & 0x80000000) + ((msb_fp << 24) & 0xFF000000) + (mant_fp);
-
-	return FP;
-}
-/*****************************************************************/
 VarFltst float_expand23(int _fp)
 {
 	VarFltst _fRes;
@@ -274,4 +235,62 @@ VarFltst float_add23(VarFltst _aa, VarFltst _bb, char addsub)
 
 	return CC;
 }
-/*****************************************************************/
\ No newline at end of file
+/*****************************************************************/
+// Normalization of fp23 adder: MSB of sum in [17:2], no MSB - shift by 31
+static VarFltst float_norm23(int _ex, int _sig, long long sum_man)
+{
+	VarFltst CC;
+	int lead = (int)((sum_man >> 2) & 0xFFFF);
+	int msbn = (lead == 0) ? 31 : (15 - fp_msb_pos(lead));
+
+	long long LUT = (sum_man >> 1) << msbn;
+
+	if ((_ex - msbn) < 0)
+		CC.ex  = 0x0;
+	else
+		CC.ex  = (_ex - msbn) + 1;
+	CC.sig = _sig;
+	CC.man = (int)(LUT & 0x0000FFFF);
+	return CC;
+}
+/*****************************************************************/
+// A+B and A-B with one compare, swap and alignment (fp23_addsub_dbl)
+void float_addsub23(VarFltst _aa, VarFltst _bb, VarFltst* _sum, VarFltst* _dif)
+{
+	VarFltst AA = _aa;
+	VarFltst BB = _bb;
+
+	int Aexpman = (_aa.ex << 16) | _aa.man;
+	int Bexpman = (_bb.ex << 16) | _bb.man;
+
+	int swap = ((Aexpman - Bexpman) < 0);
+	if (swap)
+	{
+		AA = _bb;
+		BB = _aa;
+	}
+
+	if (AA.ex != 0)
+		AA.man |= 0x00010000;
+	if (BB.ex != 0)
+		BB.man |= 0x00010000;
+
+	int exp_dif = (AA.ex-BB.ex) & 0xF;
+	int mant = BB.man >> exp_dif;
+	
+	int exp3 = (AA.ex-BB.ex) & 0x30;
+	if (exp3 != 0)
+		mant = 0x0;
+
+	long long man_add = AA.man + mant;
+	long long man_sub = AA.man - mant;
+
+	// A-B: sign of B is inverted, result sign is taken from larger operand
+	int Csub = _aa.sig ^ _bb.sig;
+	int sig_add = swap ? _bb.sig : _aa.sig;
+	int sig_sub = swap ? (~_bb.sig & 0x1) : _aa.sig;
+
+	*_sum = float_norm23(AA.ex, sig_add, (Csub == 0) ? man_add : man_sub);
+	*_dif = float_norm23(AA.ex, sig_sub, (Csub == 0) ? man_sub : man_add);
+}
+/*****************************************************************/
@@ -1,3 +1,6 @@
+#ifndef FP_OP_H
+#define FP_OP_H
+
 // ---------------- constants ---------------- //
 #define pi 3.141592653589793238462643383279502884
 
@@ -5,10 +8,27 @@
 #define _log2x(a) int(log(double(N_FFT/8192))/log(2.0))
 
 
+#define _PATH "H:\\Work\\_MATH\\"	// Data and twiddle files of main (batch runner: paths from job spec)
+
 #define N_FFT 4096//1024//2048//4096//8192//16384//32768//65536/
 #define SCALE 0x1C	// Scale factor for FFT/IFFT
+#define _BFP 0	// 1 - auto scale (block floating point), 0 - use SCALE
 #define _Tay 1	// 1 - use Teylor coeffs, 0 - don't use
 
+#define _WIN 'r'	// Input window: 'r' - none, 'h' - Hann, 'b' - Blackman, 'k' - Kaiser
+#define _KAISER 8.6	// Kaiser window: beta
+
+#define _PROF 0	// 1 - profile stages: HW counters (perf_event_open) or time only
+#define _RDX 2	// 2 - radix-2 (bit-exact to cores), 4 - radix-2^2 analysis mode (half passes, not bit-exact)
+#define _VRF 0	// 1 - verify fp23 operators (FpGeneric<6, 16>, FpFmt23) vs reference and exit
+#define _VRF_STEP 0x3FF	// Verify: mantissa step for binary operators (1 - all 2^32 pairs per class)
+
+#define _CACHE 0	// 1 - result cache of main in _PATH "cache" (see fp_cache.cpp), hit - no FFT
+#define FP_MODEL 1	// Model version in cache keys: increase with any change of output bits
+
+#define FP_EXP 6	// Float format: exponent width (fp23 - 6)
+#define FP_MAN 16	// Float format: mantissa width (fp23 - 16), see FP_FORMATS
+
 // ---------------- structures ---------------- //
 struct VarFltst
 {
@@ -28,14 +48,227 @@ struct ComplexInt {
 	int im;
 };
 
+// ---------------- profiling ---------------- //
+struct ProfEvent
+{
+	const char* name;
+	int stage;
+	double t_start;	// ns from Prof_Open
+	double t_ns;
+	long long cycles;	// -1 - no HW counters
+	long long instrs;
+	long long llc_miss;
+	long long br_miss;
+};
+
+void Prof_Open();
+void Prof_Begin();
+void Prof_End(const char* name, int stage);
+void Prof_Dump(const char* fname, char fmt); // fmt: 'j' - JSON, 'c' - CSV
+void Prof_Close();
+
+#if (_PROF == 1)
+#define PROF_BEGIN() Prof_Begin()
+#define PROF_END(name, stage) Prof_End(name, stage)
+#else
+#define PROF_BEGIN()
+#define PROF_END(name, stage)
+#endif
+
 // ---------------- reverse ---------------- //
 void fill_reverse(int m);
-extern int Reverse[65536];
+int reverse_nbit(int x, int stages);
+extern int Reverse[262144];
+
+// ---------------- output views ---------------- //
+// FFT result in _AF without copies: FFT data is bit-reversed, IFFT data is natural
+struct FftView
+{
+	ComplexVarFltst* buf;
+	int n_fft;
+	char _inv;	// 'f' - FFT, 'i' - IFFT
+	char ord;	// 'n' - natural, 'r' - bit-reversed, 'a'/'b' - A/B outputs of last butterflies (_AR/_BR)
+	const int* rev;	// bit-reverse table of plan
+
+	int size() const
+	{
+		return ((ord == 'a') || (ord == 'b')) ? n_fft/2 : n_fft;
+	}
+	int index(int ii) const
+	{
+		if (ord == 'a')
+			return (_inv == 'f') ? 2*ii : ii;
+		if (ord == 'b')
+			return (_inv == 'f') ? 2*ii+1 : ii+n_fft/2;
+		if (ord == 'n')
+			return (_inv == 'f') ? rev[ii] : ii;
+		return (_inv == 'f') ? ii : rev[ii];
+	}
+	ComplexVarFltst& operator[](int ii) const
+	{
+		return buf[index(ii)];
+	}
+};
 // ---------------- FFTs ---------------- //
+// Plan: packed twiddles for NFFT and direction, shared by calls (read-only)
+struct FftPlan
+{
+	ComplexInt* ww;	// twiddles: 1/4-period {re, im} packed words
+	int n_ww;
+	int* rev;		// bit-reverse table
+	int n_fft;
+	int stages;
+	char _inv;		// 'f' - FFT (DIF), 'i' - IFFT (DIT)
+	char _tw;		// twiddles: 'f' - Twiddle_WW (file for fp23), 'r' - int16 ROM
+	char _rdx;		// '2' - radix-2 (bit-exact), '4' - radix-2^2 (analysis, see FLOAT_FFT_R4)
+	unsigned char* bfly;	// pruned FFT: code per butterfly (BF_*), NULL - all butterflies
+	unsigned char* bout;	// pruned FFT: codes of output mask only (Prune_Out), NULL - all bins
+	int z0;			// pruned FFT: input points [z0, z1) are zero (natural order)
+	int z1;
+	int verbose;	// print stages
+};
+
+// ---------------- pruned FFT ---------------- //
+// Codes of butterflies: stage-major, order of FLOAT_FFT loops. Pruned plans use
+// radix-2 butterflies only, computed values are bit-identical to full FFT.
+#define BF_SKIP 0	// outputs are not needed or both inputs are zero: no calculation
+#define BF_FULL 1
+#define BF_ZB 2		// B input is zero: ButterflyZ
+#define BF_ZA 3		// A input is zero: ButterflyZ
+
+// Output pruning: _mask - NFFT flags in bin order (natural), only butterflies in
+// dependency cone of these bins are calculated, other bins are undefined. Each call
+// replaces mask of previous one (zero region of Prune_In is kept).
+// Returns number of butterflies to calculate (full FFT: stages * NFFT/2)
+int Prune_Out(FftPlan* plan, const char* _mask);
+int Prune_Range(FftPlan* plan, int _k0, int _k1);	// bins [_k0, _k1)
+// Input pruning: input points [_z0, _z1) (natural order) are zero, FLOAT_FFT writes zeros there
+// (FLOAT_INPUT skips them), butterflies with zero inputs are skipped or reduced (ButterflyZ).
+// Can be used with Prune_Out, each call replaces zero region of previous one.
+// Returns number of full butterflies
+int Prune_In(FftPlan* plan, int _z0, int _z1);
+void Prune_Reset(FftPlan* plan);	// full FFT again: no output mask, no zero region
+
+// plan.ww == NULL: no twiddles (_tw = 'f', file is missing or short), only Free_FFT
+template <class FP>
+FftPlan Plan_FFT(int _nFFT, char _inv, char _tw = 'f');
+void Free_FFT(FftPlan* plan);
+FftView View_FFT(const FftPlan* plan, ComplexVarFltst* _AF, char ord);
+// in place, output order as FLOAT_FFT with _nat = 'v'; returns max exponent of output
+template <class FP>
+int FLOAT_FFT(const FftPlan* plan, ComplexVarFltst* _AF);
+void FLOAT_FFT(ComplexVarFltst* _AF, ComplexVarFltst* _AR, ComplexVarFltst* _BR, int stages, char _nat, char _inv);
+template <class FP>
 void FLOAT_FFT(ComplexVarFltst* _AF, ComplexVarFltst* _AR, ComplexVarFltst* _BR, int stages, char _nat, char _inv);
+// ---------------- windows ---------------- //
+// _type: 'r' - rectangular, 'h' - Hann, 'b' - Blackman, 'k' - Kaiser (_beta), 'u' - user (_user[NFFT]);
+// coeffs in FP as int16 ROM: fix2float(32767 * w)
+template <class FP>
+void Window_WW(int _nFFT, VarFltst* _win, char _type, double _beta, const double* _user);
+// Input stage: int16 -> FP -> * _win (NULL - none) -> _AF in first stage order of plan
+template <class FP>
+void FLOAT_INPUT(const FftPlan* plan, const int* _din_re, const int* _din_im, const VarFltst* _win, ComplexVarFltst* _AF);
+// ---------------- output ---------------- //
+// Block floating point: SCALE for max exponent (no saturation, max precision)
+template <class FP>
+int Scale_BFP(int _exmax);
+// float2fix in view order with auto scale: _blk = 0 - one scale from _exmax (FLOAT_FFT,
+// -1 - find), else one scale per _blk points; _scale[] - chosen scales
+template <class FP>
+void FLOAT_OUTPUT(const FftView* _view, int _exmax, int _blk, ComplexInt* _dout, int* _scale);
+// ---------------- STFT ---------------- //
+// Frames of NFFT samples every _hop samples: each int16 sample is converted once (ring buffer),
+// frames are windowed and calculated in parallel with one plan ('f').
+// _win - NFFT coeffs from Window_WW, NULL - rectangular;
+// _SPEC - n_frames * NFFT, order as FLOAT_FFT with _nat = 'v'. Returns n_frames.
+template <class FP>
+int FLOAT_STFT(const FftPlan* plan, const int* _din_re, const int* _din_im, int n_samples, int _hop, const VarFltst* _win, ComplexVarFltst* _SPEC);
+// ---------------- radix-2^2 analysis mode ---------------- //
+// Pairs of radix-2 stages in one pass (plan._rdx = '4'), same data orders, not bit-exact
+template <class FP>
+int FLOAT_FFT_R4(const FftPlan* plan, ComplexVarFltst* _AF);
+
+// Relative RMS errors for input _AF (not changed): radix-2 / radix-2^2 vs double FFT,
+// radix-2^2 vs radix-2; max_24 - max |R4 - R2| / max |R2|. Printed if plan.verbose
+struct FftError
+{
+	double rel_r2;
+	double rel_r4;
+	double rel_24;
+	double max_24;
+};
+template <class FP>
+void Error_FFT(const FftPlan* plan, const ComplexVarFltst* _AF, FftError* _err);
+// ---------------- batch runner ---------------- //
+// Job spec file -> BatchJob, see fp_batch.cpp. Batch_Run: input is mapped read-only and
+// shared by job.workers processes (fork), each writes its shard and index, returns failed shards
+#define BATCH_MAXCFG 16
+struct BatchJob
+{
+	char input[256];	// int16 {re, im} capture
+	char output[256];	// prefix of outputs
+	int nfft[BATCH_MAXCFG];
+	int n_nfft;
+	int scale[BATCH_MAXCFG];	// -1 - auto scale (BFP)
+	int n_scale;
+	char _inv;		// 'f' - FFT, 'i' - IFFT, 'c' - FFT + IFFT
+	char _tw;		// twiddles of plans
+	int workers;
+	char cache[256];	// result cache directory, "" - off
+};
+int Batch_Load(const char* fname, BatchJob* job);
+template <class FP>
+int Batch_Run(const BatchJob* job);
+// ---------------- result cache ---------------- //
+// Content-addressed outputs: key = FNV-1a 64 of inputs and configuration, one file per key
+// <dir>/<key>.fpc: CacheHdr + raw words (fixed header, data at offset 32: can be mapped as is)
+#define CACHE_SEED 0xCBF29CE484222325ULL
+struct CacheHdr
+{
+	char magic[4];	// "FPC1"
+	int model;		// FP_MODEL
+	unsigned long long key;
+	char type;		// 'p' - fp23 words (int32), 'i' - fix (int32), 's' - fix (int16)
+	char pad[3];
+	int n_words;
+	int info;		// caller value: scale used / max exponent
+	int reserved;
+};
+unsigned long long Cache_Hash(unsigned long long h, const void* data, long long n_bytes);
+// adds plan to key: FP_MODEL, format, NFFT, direction, _nat, _scale, twiddle values, radix, pruning
+template <class FP>
+unsigned long long Cache_Key(unsigned long long h, const FftPlan* plan, char _nat, int _scale);
+// 0 - hit (data and info are read), -1 - miss
+int Cache_Get(const char* dir, unsigned long long key, char type, void* data, int n_words, int* info);
+int Cache_Put(const char* dir, unsigned long long key, char type, const void* data, int n_words, int info);
+// ---------------- fast convolution ---------------- //
+// fp23_cmult: {A.re*B.re - A.im*B.im, A.re*B.im + A.im*B.re}
+template <class FP>
+ComplexVarFltst FLOAT_CMULT(ComplexVarFltst _aa, ComplexVarFltst _bb);
+// FFT ('f' plan), * _SF (support function: FFT of response, same order), IFFT ('i' plan)
+// in place in _AF: natural in, natural out; returns max exponent of output
+template <class FP>
+int FLOAT_FCONV(const FftPlan* plan_f, const FftPlan* plan_i, ComplexVarFltst* _AF, const ComplexVarFltst* _SF);
+// ---------------- verification ---------------- //
+// FP (EXP = 6, MAN = 16) operators vs fp23 reference: prints each operator, returns number of
+// mismatched operators (first mismatch is printed with operands), -1 - not fp23 format.
+// _ops: 'a' - all operators, 's' - addsub only (FpFmt23 forwards the others to the reference)
+template <class FP>
+int Verify_FP23(int _man_step, char _ops);
 // ---------------- butterflies ---------------- //
 void ButterflyFP(ComplexVarFltst *FA, ComplexVarFltst *FB, ComplexVarFltst *FcoeArr, int aa, int bb, int ww, int stage, char decim, int _use);
-void Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs);
+template <class FP>
+void ButterflyFP(ComplexVarFltst *FA, ComplexVarFltst *FB, ComplexVarFltst *FcoeArr, int aa, int bb, int ww, int stage, char decim, int _use);
+template <class FP>
+void ButterflyZ(ComplexVarFltst *FA, const ComplexVarFltst *WW, int aa, int bb, int code, char decim);
+// 0 - ok, -1 - twiddle file is missing or short
+int Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs);
+template <class FP>
+int Twiddle_WW(int _nFFT, ComplexVarFltst* CFPW, int coefs);
+template <class FP>
+void Twiddle_ROM(int _nFFT, ComplexVarFltst* CFPW);
+template <class FP>
+ComplexInt* Twiddle_WQ(int _nFFT, int coefs, int* n_ww, char _tw);
 // ---------------- float operators ---------------- // 
 int fix2float23(int _fix);
 int float2fix23(int _fp, int _scale);
@@ -44,4 +277,7 @@ VarFltst float_expand23(int _fp);
 int float_collapse23(VarFltst fRes);
 
 VarFltst float_mult23(VarFltst _aa, VarFltst _bb);
-VarFltst float_add23(VarFltst _aa, VarFltst _bb, char addsub); // decim = 0 - DIF, decim = 1 - DIT
\ No newline at end of file
+VarFltst float_add23(VarFltst _aa, VarFltst _bb, char addsub); // decim = 0 - DIF, decim = 1 - DIT
+void float_addsub23(VarFltst _aa, VarFltst _bb, VarFltst* _sum, VarFltst* _dif); // A+B, A-B
+
+#endif
@@ -0,0 +1,210 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+
+#include "fp_op.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// ---------------- counters ---------------- //
+#define PROF_NCNT 4	// cycles, instructions, LLC misses, branch misses
+#define PROF_DEPTH 8
+
+static int prof_fd[PROF_NCNT] = {-1, -1, -1, -1};
+static int prof_hw = 0;
+static double prof_t0 = 0.0;
+
+static ProfEvent* prof_ev = NULL;
+static int prof_nev = 0;
+static int prof_max = 0;
+
+static int prof_top = 0;
+static double prof_st_t[PROF_DEPTH];
+static long long prof_st_c[PROF_DEPTH][PROF_NCNT];
+
+static double prof_time_ns()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER cnt, frq;
+	QueryPerformanceCounter(&cnt);
+	QueryPerformanceFrequency(&frq);
+	return (double)cnt.QuadPart * 1e9 / (double)frq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+static void prof_read(long long* cnt)
+{
+	for (int ii = 0; ii < PROF_NCNT; ii++)
+		cnt[ii] = -1;
+#if defined(__linux__)
+	if (prof_hw == 0)
+		return;
+	// group: {nr, values[nr]}
+	long long buf[1 + PROF_NCNT];
+	if (read(prof_fd[0], buf, sizeof(buf)) == (ssize_t)sizeof(buf))
+	{
+		for (int ii = 0; ii < PROF_NCNT; ii++)
+			cnt[ii] = buf[1 + ii];
+	}
+#endif
+}
+
+void Prof_Open()
+{
+#if defined(__linux__)
+	const unsigned long long cfg[PROF_NCNT] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+	prof_hw = 1;
+	for (int ii = 0; ii < PROF_NCNT; ii++)
+	{
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = cfg[ii];
+		attr.disabled = (ii == 0);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+
+		prof_fd[ii] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, (ii == 0) ? -1 : prof_fd[0], 0);
+		if (prof_fd[ii] < 0)
+		{
+			prof_hw = 0;
+			break;
+		}
+	}
+	if (prof_hw == 1)
+	{
+		ioctl(prof_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(prof_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+	else
+	{
+		for (int ii = 0; ii < PROF_NCNT; ii++)
+		{
+			if (prof_fd[ii] >= 0)
+				close(prof_fd[ii]);
+			prof_fd[ii] = -1;
+		}
+	}
+#endif
+	if (prof_hw == 0)
+		printf("Profiling: no HW counters, time only\n");
+
+	prof_nev = 0;
+	prof_top = 0;
+	prof_t0 = prof_time_ns();
+}
+
+// single thread only: calls from parallel regions (STFT frames) are skipped
+static int prof_skip()
+{
+#ifdef _OPENMP
+	if (omp_in_parallel())
+		return 1;
+#endif
+	return 0;
+}
+
+void Prof_Begin()
+{
+	if (prof_skip() || (prof_top >= PROF_DEPTH))
+		return;
+	prof_read(prof_st_c[prof_top]);
+	prof_st_t[prof_top] = prof_time_ns();
+	prof_top++;
+}
+
+void Prof_End(const char* name, int stage)
+{
+	if (prof_skip() || (prof_top <= 0))
+		return;
+	long long cnt[PROF_NCNT];
+	double tt = prof_time_ns();
+	prof_read(cnt);
+	prof_top--;
+
+	if (prof_nev == prof_max)
+	{
+		prof_max = (prof_max == 0) ? 256 : (2 * prof_max);
+		prof_ev = (ProfEvent*)realloc(prof_ev, prof_max * sizeof(ProfEvent));
+	}
+	ProfEvent* ev = &prof_ev[prof_nev++];
+	ev->name = name;
+	ev->stage = stage;
+	ev->t_start = prof_st_t[prof_top] - prof_t0;
+	ev->t_ns = tt - prof_st_t[prof_top];
+	long long* dst[PROF_NCNT] = {&ev->cycles, &ev->instrs, &ev->llc_miss, &ev->br_miss};
+	for (int ii = 0; ii < PROF_NCNT; ii++)
+		*dst[ii] = (cnt[ii] < 0) ? -1 : (cnt[ii] - prof_st_c[prof_top][ii]);
+}
+
+void Prof_Dump(const char* fname, char fmt)
+{
+	FILE* FPR = fopen(fname, "wt");
+	if (FPR == NULL)
+	{
+		printf("Cannot open profile file %s\n", fname);
+		return;
+	}
+	if (fmt == 'j')
+		fprintf(FPR, "[\n");
+	else
+		fprintf(FPR, "name,stage,t_start_ns,t_ns,cycles,instructions,llc_misses,branch_misses\n");
+
+	for (int ii = 0; ii < prof_nev; ii++)
+	{
+		ProfEvent* ev = &prof_ev[ii];
+		if (fmt == 'j')
+			fprintf(FPR, "  {\"name\": \"%s\", \"stage\": %d, \"t_start_ns\": %.0f, \"t_ns\": %.0f, \"cycles\": %lld, \"instructions\": %lld, \"llc_misses\": %lld, \"branch_misses\": %lld}%s\n",
+				ev->name, ev->stage, ev->t_start, ev->t_ns, ev->cycles, ev->instrs, ev->llc_miss, ev->br_miss, (ii + 1 < prof_nev) ? "," : "");
+		else
+			fprintf(FPR, "%s,%d,%.0f,%.0f,%lld,%lld,%lld,%lld\n",
+				ev->name, ev->stage, ev->t_start, ev->t_ns, ev->cycles, ev->instrs, ev->llc_miss, ev->br_miss);
+	}
+	if (fmt == 'j')
+		fprintf(FPR, "]\n");
+	fclose(FPR);
+}
+
+void Prof_Close()
+{
+#if defined(__linux__)
+	for (int ii = 0; ii < PROF_NCNT; ii++)
+	{
+		if (prof_fd[ii] >= 0)
+			close(prof_fd[ii]);
+		prof_fd[ii] = -1;
+	}
+#endif
+	prof_hw = 0;
+	free(prof_ev);
+	prof_ev = NULL;
+	prof_nev = 0;
+	prof_max = 0;
+}
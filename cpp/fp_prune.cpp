@@ -0,0 +1,155 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+
+#include "fp_op.h"
+
+// ---------------- pruned FFT: butterfly codes ---------------- //
+// plan->bfly[(cnt-1)*NFFT/2 + counter]: counter - butterfly number in stage
+// loop of FLOAT_FFT (jj outer, ii inner)
+
+// A/B positions of butterfly in stage cnt (as FLOAT_FFT loops)
+static void Bfly_Pair(const FftPlan* plan, int cnt, int counter, int* aa, int* bb)
+{
+	int nFFT = plan->n_fft;
+	if (plan->_inv == 'f')
+	{
+		int iN = nFFT >> cnt;
+		int jN = (counter % iN) + (counter / iN) * (nFFT >> (cnt - 1));
+		*aa = jN;
+		*bb = jN + iN;
+	}
+	else
+	{
+		int iN = 1 << (cnt - 1);
+		int jN = (counter % iN) + (counter / iN) * (1 << cnt);
+		*aa = jN;
+		*bb = jN + iN;
+	}
+}
+
+static void Prune_Alloc(unsigned char** codes, int n_bf)
+{
+	if (*codes == NULL)
+		*codes = (unsigned char*)malloc(n_bf);
+	memset(*codes, BF_FULL, n_bf);
+}
+
+// Zero flags of input region [z0, z1) go through stages: codes of butterflies
+// which are calculated (BF_FULL) are reduced. Returns number of full butterflies
+static int Prune_Zero(FftPlan* plan)
+{
+	int nFFT = plan->n_fft;
+	int n_bf = nFFT / 2;
+
+	// ZERO: positions in buffer (DIT input is bit-reversed)
+	char* zero = (char*)malloc(nFFT);
+	for (int ii = 0; ii < nFFT; ii++)
+	{
+		int nat = (plan->_inv == 'f') ? ii : plan->rev[ii];
+		zero[ii] = (nat >= plan->z0) && (nat < plan->z1);
+	}
+
+	int n_full = 0;
+	for (int cnt = 1; cnt <= plan->stages; cnt++)
+	{
+		unsigned char* code = plan->bfly + (cnt - 1) * n_bf;
+		for (int kk = 0; kk < n_bf; kk++)
+		{
+			int aa, bb;
+			Bfly_Pair(plan, cnt, kk, &aa, &bb);
+			if (code[kk] == BF_FULL)
+			{
+				if (zero[aa] && zero[bb])
+					code[kk] = BF_SKIP;
+				else if (zero[bb])
+					code[kk] = BF_ZB;
+				else if (zero[aa])
+					code[kk] = BF_ZA;
+			}
+			n_full += (code[kk] == BF_FULL);
+			// outputs are zero only for zero inputs
+			zero[aa] = zero[bb] = (zero[aa] && zero[bb]);
+		}
+	}
+	free(zero);
+	return n_full;
+}
+
+// bfly = output codes (Prune_Out) reduced by zero region (Prune_In)
+static int Prune_Build(FftPlan* plan)
+{
+	int n_bf = plan->stages * (plan->n_fft / 2);
+	Prune_Alloc(&plan->bfly, n_bf);
+	if (plan->bout != NULL)
+		memcpy(plan->bfly, plan->bout, n_bf);
+	return Prune_Zero(plan);
+}
+
+// Output pruning: only butterflies in dependency cone of _mask bins
+int Prune_Out(FftPlan* plan, const char* _mask)
+{
+	int nFFT = plan->n_fft;
+	int n_bf = nFFT / 2;
+	// new mask: codes of previous one are cleared
+	Prune_Alloc(&plan->bout, plan->stages * n_bf);
+
+	// NEED: positions after stage (last stage: bins in buffer order)
+	char* need = (char*)malloc(nFFT);
+	for (int ii = 0; ii < nFFT; ii++)
+	{
+		int bin = (plan->_inv == 'f') ? plan->rev[ii] : ii;
+		need[ii] = (_mask[bin] != 0);
+	}
+
+	for (int cnt = plan->stages; cnt >= 1; cnt--)
+	{
+		unsigned char* code = plan->bout + (cnt - 1) * n_bf;
+		for (int kk = 0; kk < n_bf; kk++)
+		{
+			int aa, bb;
+			Bfly_Pair(plan, cnt, kk, &aa, &bb);
+			if ((need[aa] == 0) && (need[bb] == 0))
+				code[kk] = BF_SKIP;
+			// both inputs are needed by A or B output
+			need[aa] = need[bb] = (code[kk] != BF_SKIP);
+		}
+	}
+	free(need);
+
+	Prune_Build(plan);
+	int n_use = 0;
+	for (int kk = 0; kk < plan->stages * n_bf; kk++)
+		n_use += (plan->bfly[kk] != BF_SKIP);
+	return n_use;
+}
+
+int Prune_Range(FftPlan* plan, int _k0, int _k1)
+{
+	char* mask = (char*)malloc(plan->n_fft);
+	for (int ii = 0; ii < plan->n_fft; ii++)
+		mask[ii] = (ii >= _k0) && (ii < _k1);
+	int n_use = Prune_Out(plan, mask);
+	free(mask);
+	return n_use;
+}
+
+// Input pruning: new zero region replaces previous one, output mask is kept
+int Prune_In(FftPlan* plan, int _z0, int _z1)
+{
+	int nFFT = plan->n_fft;
+	plan->z0 = (_z0 < 0) ? 0 : _z0;
+	plan->z1 = (_z1 > nFFT) ? nFFT : _z1;
+	return Prune_Build(plan);
+}
+
+void Prune_Reset(FftPlan* plan)
+{
+	free(plan->bfly);
+	free(plan->bout);
+	plan->bfly = NULL;
+	plan->bout = NULL;
+	plan->z0 = 0;
+	plan->z1 = 0;
+}
@@ -0,0 +1,274 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <math.h>
+#include <cstdlib>
+#include <cstring>
+
+#include "fp_fmt.h"
+
+// ---------------- radix-2^2: analysis mode ---------------- //
+// Two radix-2 stages in one pass over 4 points: W_L^(L/4) = -j (+j for IFFT) is
+// exact (swap, sign), 3 twiddles per 4 points instead of 4. Same orders as
+// FLOAT_FFT (FFT: natural -> bit-reversed, IFFT: bit-reversed -> natural),
+// fp23 operators, but NOT bit-exact to the radix-2 cores.
+
+// W_N^m for 0 <= m < N: W^(m + N/2) = -W^m
+template <class FP>
+static inline ComplexVarFltst Twiddle_Get(const FftPlan* plan, int m)
+{
+	int half = plan->n_fft / 2;
+	int n_ww = plan->n_ww;
+	int ww = (m < half) ? m : (m - half);
+	ComplexVarFltst W;
+	if (ww < n_ww)
+	{
+		W.re = FP::expand(plan->ww[ww].re);
+		W.im = FP::expand(plan->ww[ww].im);
+	}
+	else
+	{
+		W.re = FP::expand(plan->ww[ww - n_ww].im);
+		W.im = FP::expand(plan->ww[ww - n_ww].re);
+		W.im.sig ^= 0x1;
+	}
+	if (m >= half)
+	{
+		W.re.sig ^= 0x1;
+		W.im.sig ^= 0x1;
+	}
+	// IFFT (DIT butterfly): B * conj(W)
+	if (plan->_inv == 'i')
+		W.im.sig ^= 0x1;
+	return W;
+}
+
+// A + B, A - B for complex
+template <class FP>
+static inline void Cplx_AddSub(ComplexVarFltst _aa, ComplexVarFltst _bb, ComplexVarFltst* _sum, ComplexVarFltst* _dif)
+{
+	FP::addsub(_aa.re, _bb.re, &_sum->re, &_dif->re);
+	FP::addsub(_aa.im, _bb.im, &_sum->im, &_dif->im);
+}
+
+// A * (+j) or A * (-j): _neg = 1 for -j
+static inline ComplexVarFltst Cplx_RotJ(ComplexVarFltst _aa, int _neg)
+{
+	ComplexVarFltst CC;
+	CC.re = _aa.im;
+	CC.im = _aa.re;
+	if (_neg)
+		CC.im.sig ^= 0x1;
+	else
+		CC.re.sig ^= 0x1;
+	return CC;
+}
+
+template <class FP>
+int FLOAT_FFT_R4(const FftPlan* plan, ComplexVarFltst* _AF)
+{
+	int nFFT = plan->n_fft;
+	int stages = plan->stages;
+	ComplexVarFltst* Cx = _AF;
+
+	// W_4^1: -j for FFT, +j for IFFT (sign from twiddle table)
+	int rneg = Twiddle_Get<FP>(plan, nFFT / 4).im.sig;
+	ComplexVarFltst W0 = Twiddle_Get<FP>(plan, 0);
+
+	if (plan->_inv == 'f')
+	{
+		int cnt = 1;
+		for (; cnt + 1 <= stages; cnt += 2)
+		{
+			if (plan->verbose)
+				printf("Fwd FFT stages (R2^2): 0x%02X\n", cnt);
+			PROF_BEGIN();
+			int L = nFFT >> (cnt - 1);
+			int Q = L / 4;
+			int step = nFFT / L;
+			for (int bb = 0; bb < nFFT; bb += L)
+			{
+				for (int kk = 0; kk < Q; kk++)
+				{
+					ComplexVarFltst* Xx = Cx + bb + kk;
+					ComplexVarFltst S02, D02, S13, D13, Y0, Y1, Y2, Y3;
+					Cplx_AddSub<FP>(Xx[0], Xx[2*Q], &S02, &D02);
+					Cplx_AddSub<FP>(Xx[Q], Xx[3*Q], &S13, &D13);
+					Cplx_AddSub<FP>(S02, S13, &Y0, &Y1);
+					Cplx_AddSub<FP>(D02, Cplx_RotJ(D13, rneg), &Y2, &Y3);
+
+					Xx[0]   = Y0;
+					Xx[Q]   = FLOAT_CMULT<FP>(Y1, Twiddle_Get<FP>(plan, 2*kk*step));
+					Xx[2*Q] = FLOAT_CMULT<FP>(Y2, Twiddle_Get<FP>(plan, kk*step));
+					Xx[3*Q] = FLOAT_CMULT<FP>(Y3, Twiddle_Get<FP>(plan, 3*kk*step));
+				}
+			}
+			PROF_END("fft_stage", cnt);
+		}
+		// odd number of stages: last radix-2 stage, W = W^0
+		if (cnt == stages)
+		{
+			int iN = nFFT >> cnt;
+			for (int jN = 0; jN < nFFT; jN += 2*iN)
+				for (int ii = 0; ii < iN; ii++)
+					ButterflyFP<FP>(Cx, Cx, &W0, jN+ii, jN+ii+iN, 0, cnt, 'f', 1);
+		}
+	}
+	else if (plan->_inv == 'i')
+	{
+		// odd number of stages: first radix-2 stage, W = W^0
+		int cnt = 1;
+		if (stages & 0x1)
+		{
+			W0.im.sig ^= 0x1;	// ButterflyFP 't' takes conj(W) itself
+			for (int jN = 0; jN < nFFT; jN += 2)
+				ButterflyFP<FP>(Cx, Cx, &W0, jN, jN+1, 0, cnt, 't', 1);
+			cnt++;
+		}
+		for (; cnt + 1 <= stages; cnt += 2)
+		{
+			if (plan->verbose)
+				printf("Inv FFT stages (R2^2): 0x%02X\n", cnt);
+			PROF_BEGIN();
+			int L = 1 << (cnt + 1);
+			int Q = L / 4;
+			int step = nFFT / L;
+			for (int bb = 0; bb < nFFT; bb += L)
+			{
+				for (int kk = 0; kk < Q; kk++)
+				{
+					ComplexVarFltst* Xx = Cx + bb + kk;
+					ComplexVarFltst AA = Xx[0];
+					ComplexVarFltst BB = FLOAT_CMULT<FP>(Xx[Q], Twiddle_Get<FP>(plan, 2*kk*step));
+					ComplexVarFltst CC = FLOAT_CMULT<FP>(Xx[2*Q], Twiddle_Get<FP>(plan, kk*step));
+					ComplexVarFltst DD = FLOAT_CMULT<FP>(Xx[3*Q], Twiddle_Get<FP>(plan, 3*kk*step));
+
+					ComplexVarFltst SAB, DAB, SCD, DCD;
+					Cplx_AddSub<FP>(AA, BB, &SAB, &DAB);
+					Cplx_AddSub<FP>(CC, DD, &SCD, &DCD);
+					Cplx_AddSub<FP>(SAB, SCD, &Xx[0], &Xx[2*Q]);
+					Cplx_AddSub<FP>(DAB, Cplx_RotJ(DCD, rneg), &Xx[Q], &Xx[3*Q]);
+				}
+			}
+			PROF_END("ifft_stage", cnt);
+		}
+	}
+	else
+	{
+		printf("**** CANNOT CALCULATE FFT/IFFT (SET _INV to 'f' or 'i') ****\n\n");
+		return -1;
+	}
+
+	int exmax = -1;
+	for (int ii = 0; ii < nFFT; ii++)
+	{
+		int ex_re = FP::exp_of(Cx[ii].re);
+		int ex_im = FP::exp_of(Cx[ii].im);
+		if (ex_re > exmax)
+			exmax = ex_re;
+		if (ex_im > exmax)
+			exmax = ex_im;
+	}
+	return exmax;
+}
+
+// ---------------- error: radix-2^2 vs radix-2 vs double ---------------- //
+template <class FP>
+static inline double Fp_Value(VarFltst _fp)
+{
+	double man = (double)((_fp.ex != 0) ? (_fp.man | FP::IMP_BIT) : _fp.man);
+	double val = ldexp(man, _fp.ex - FP::MAN);
+	return (_fp.sig == 1) ? -val : val;
+}
+
+// double DIF: natural in, bit-reversed out; _sgn = -1 - FFT, +1 - IFFT
+static void Double_FFT(double* _re, double* _im, int _nFFT, int _sgn)
+{
+	for (int L = _nFFT; L >= 2; L >>= 1)
+	{
+		int half = L / 2;
+		for (int bb = 0; bb < _nFFT; bb += L)
+		{
+			for (int kk = 0; kk < half; kk++)
+			{
+				double wr = cos(2.0 * pi * kk / L);
+				double wi = _sgn * sin(2.0 * pi * kk / L);
+				int aa = bb + kk;
+				int cc = aa + half;
+				double dr = _re[aa] - _re[cc];
+				double di = _im[aa] - _im[cc];
+				_re[aa] += _re[cc];
+				_im[aa] += _im[cc];
+				_re[cc] = dr * wr - di * wi;
+				_im[cc] = dr * wi + di * wr;
+			}
+		}
+	}
+}
+
+template <class FP>
+void Error_FFT(const FftPlan* plan, const ComplexVarFltst* _AF, FftError* _err)
+{
+	int nFFT = plan->n_fft;
+	FftPlan p2 = *plan;
+	FftPlan p4 = *plan;
+	p2._rdx = '2';
+	p4._rdx = '4';
+	p2.verbose = 0;
+	p4.verbose = 0;
+
+	ComplexVarFltst* X2 = (ComplexVarFltst*)malloc(nFFT * sizeof(ComplexVarFltst));
+	ComplexVarFltst* X4 = (ComplexVarFltst*)malloc(nFFT * sizeof(ComplexVarFltst));
+	double* Dre = (double*)malloc(nFFT * sizeof(double));
+	double* Dim = (double*)malloc(nFFT * sizeof(double));
+	memcpy(X2, _AF, nFFT * sizeof(ComplexVarFltst));
+	memcpy(X4, _AF, nFFT * sizeof(ComplexVarFltst));
+	FLOAT_FFT<FP>(&p2, X2);
+	FLOAT_FFT<FP>(&p4, X4);
+
+	// reference: same input, natural order for IFFT
+	for (int ii = 0; ii < nFFT; ii++)
+	{
+		int src = (plan->_inv == 'f') ? ii : plan->rev[ii];
+		Dre[ii] = Fp_Value<FP>(_AF[src].re);
+		Dim[ii] = Fp_Value<FP>(_AF[src].im);
+	}
+	Double_FFT(Dre, Dim, nFFT, (plan->_inv == 'f') ? -1 : 1);
+
+	double e_d = 0.0, e_2 = 0.0, e_4 = 0.0, e_24 = 0.0, m_2 = 0.0, m_24 = 0.0;
+	for (int ii = 0; ii < nFFT; ii++)
+	{
+		// reference is bit-reversed: FFT output order, IFFT output is natural
+		int rr = (plan->_inv == 'f') ? ii : plan->rev[ii];
+		double r2 = Fp_Value<FP>(X2[ii].re), i2 = Fp_Value<FP>(X2[ii].im);
+		double r4 = Fp_Value<FP>(X4[ii].re), i4 = Fp_Value<FP>(X4[ii].im);
+
+		e_d += Dre[rr] * Dre[rr] + Dim[rr] * Dim[rr];
+		e_2 += (r2 - Dre[rr]) * (r2 - Dre[rr]) + (i2 - Dim[rr]) * (i2 - Dim[rr]);
+		e_4 += (r4 - Dre[rr]) * (r4 - Dre[rr]) + (i4 - Dim[rr]) * (i4 - Dim[rr]);
+		e_24 += (r4 - r2) * (r4 - r2) + (i4 - i2) * (i4 - i2);
+
+		double a2 = sqrt(r2 * r2 + i2 * i2);
+		double a24 = sqrt((r4 - r2) * (r4 - r2) + (i4 - i2) * (i4 - i2));
+		if (a2 > m_2)
+			m_2 = a2;
+		if (a24 > m_24)
+			m_24 = a24;
+	}
+	_err->rel_r2 = (e_d > 0.0) ? sqrt(e_2 / e_d) : 0.0;
+	_err->rel_r4 = (e_d > 0.0) ? sqrt(e_4 / e_d) : 0.0;
+	_err->rel_24 = (e_d > 0.0) ? sqrt(e_24 / e_d) : 0.0;
+	_err->max_24 = (m_2 > 0.0) ? (m_24 / m_2) : 0.0;
+	if (plan->verbose)
+		printf("%s error (rel. RMS): R2 vs double %.3e, R2^2 vs double %.3e, R2^2 vs R2 %.3e (max %.3e)\n",
+			(plan->_inv == 'f') ? "FFT" : "IFFT", _err->rel_r2, _err->rel_r4, _err->rel_24, _err->max_24);
+
+	free(X2);
+	free(X4);
+	free(Dre);
+	free(Dim);
+}
+
+#define INST_RDX4(FP) \
+	template int FLOAT_FFT_R4<FP>(const FftPlan* plan, ComplexVarFltst* _AF); \
+	template void Error_FFT<FP>(const FftPlan* plan, const ComplexVarFltst* _AF, FftError* _err);
+FP_FORMATS(INST_RDX4)
@@ -310,3 +310,14 @@ void fill_reverse(int m)
 	}
 	//return reverse[j];
 }
+
+int reverse_nbit(int x, int stages)
+{
+	int h = 0;
+	for (int j = 0; j < stages; j++)
+	{
+		h = (h << 1) | (x & 1);
+		x >>= 1;
+	}
+	return h;
+}
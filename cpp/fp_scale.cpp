@@ -0,0 +1,56 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cstdlib>
+
+#include "fp_fmt.h"
+
+template <class FP>
+int Scale_BFP(int _exmax)
+{
+	// float2fix: shift = exp - scale, saturation for shift >= 15
+	return _exmax - 14 - (FP::FIX_BIAS - 0x10);
+}
+
+template <class FP>
+void FLOAT_OUTPUT(const FftView* _view, int _exmax, int _blk, ComplexInt* _dout, int* _scale)
+{
+	int nn = _view->size();
+	if (_blk <= 0)
+		_blk = nn;
+
+	PROF_BEGIN();
+	for (int b0 = 0; b0 < nn; b0 += _blk)
+	{
+		int b1 = (b0 + _blk < nn) ? (b0 + _blk) : nn;
+
+		// per frame: max exponent from last stage of FLOAT_FFT, per block: block is in cache
+		int exmax = _exmax;
+		if ((_blk != nn) || (exmax < 0))
+		{
+			exmax = 0;
+			for (int ii = b0; ii < b1; ii++)
+			{
+				const ComplexVarFltst& Xx = (*_view)[ii];
+				if (FP::exp_of(Xx.re) > exmax)
+					exmax = FP::exp_of(Xx.re);
+				if (FP::exp_of(Xx.im) > exmax)
+					exmax = FP::exp_of(Xx.im);
+			}
+		}
+
+		int scale = Scale_BFP<FP>(exmax);
+		_scale[b0 / _blk] = scale;
+		for (int ii = b0; ii < b1; ii++)
+		{
+			const ComplexVarFltst& Xx = (*_view)[ii];
+			_dout[ii].re = FP::float2fix(FP::collapse(Xx.re), scale);
+			_dout[ii].im = FP::float2fix(FP::collapse(Xx.im), scale);
+		}
+	}
+	PROF_END("float2fix", 0);
+}
+
+#define INST_SCALE(FP) \
+	template int Scale_BFP<FP>(int _exmax); \
+	template void FLOAT_OUTPUT<FP>(const FftView* _view, int _exmax, int _blk, ComplexInt* _dout, int* _scale);
+FP_FORMATS(INST_SCALE)
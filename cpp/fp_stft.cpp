@@ -0,0 +1,75 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <math.h>
+#include <cstdlib>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "fp_fmt.h"
+
+template <class FP>
+int FLOAT_STFT(const FftPlan* plan, const int* _din_re, const int* _din_im, int n_samples, int _hop, const VarFltst* _win, ComplexVarFltst* _SPEC)
+{
+	int nFFT = plan->n_fft;
+	if ((_hop <= 0) || (n_samples < nFFT))
+		return 0;
+	int n_frames = (n_samples - nFFT) / _hop + 1;
+
+	// frames in parallel: one batch per pass
+	int n_par = 1;
+#ifdef _OPENMP
+	n_par = omp_get_max_threads();
+#endif
+	if (n_par > n_frames)
+		n_par = n_frames;
+
+	// RING BUFFER: all samples of one batch
+	int n_ring = 1;
+	while (n_ring < nFFT + (n_par - 1) * _hop)
+		n_ring <<= 1;
+	int ring_msk = n_ring - 1;
+	ComplexVarFltst* Rx = (ComplexVarFltst*)malloc(n_ring * sizeof(ComplexVarFltst));
+
+	int n_conv = 0;
+	for (int f0 = 0; f0 < n_frames; f0 += n_par)
+	{
+		int f1 = (f0 + n_par < n_frames) ? (f0 + n_par) : n_frames;
+
+		// FIX2FLOAT: only new samples
+		int s0 = (n_conv > f0 * _hop) ? n_conv : (f0 * _hop);
+		int s1 = (f1 - 1) * _hop + nFFT;
+		#pragma omp parallel for
+		for (int ii = s0; ii < s1; ii++)
+		{
+			Rx[ii & ring_msk].re = FP::expand(FP::fix2float(_din_re[ii]));
+			Rx[ii & ring_msk].im = FP::expand(FP::fix2float(_din_im[ii]));
+		}
+		n_conv = s1;
+
+		// WINDOW + FFT: each frame in place in _SPEC
+		#pragma omp parallel for
+		for (int ff = f0; ff < f1; ff++)
+		{
+			ComplexVarFltst* Fx = _SPEC + (long long)ff * nFFT;
+			int start = ff * _hop;
+			for (int ii = 0; ii < nFFT; ii++)
+			{
+				ComplexVarFltst Xx = Rx[(start + ii) & ring_msk];
+				if (_win != NULL)
+				{
+					Xx.re = FP::mult(Xx.re, _win[ii]);
+					Xx.im = FP::mult(Xx.im, _win[ii]);
+				}
+				Fx[ii] = Xx;
+			}
+			FLOAT_FFT<FP>(plan, Fx);
+		}
+	}
+	free(Rx);
+	return n_frames;
+}
+
+#define INST_STFT(FP) \
+	template int FLOAT_STFT<FP>(const FftPlan* plan, const int* _din_re, const int* _din_im, int n_samples, int _hop, const VarFltst* _win, ComplexVarFltst* _SPEC);
+FP_FORMATS(INST_STFT)
@@ -0,0 +1,218 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cstdlib>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "fp_fmt.h"
+
+// ---------------- fp23 operators vs reference (fp_op.cpp) ---------------- //
+// fix2float:	all 2^16 int16
+// float2fix:	all 2^23 words for each scale 0..63
+// add/sub/mult/addsub: each class {sign A, sign B, exp A, exp B} (all exponent
+//				differences), mantissas: every _man_step + edge values, A x B
+// Exponents < 0: unnormalized mult outputs (butterfly: W * B -> addsub), operands are
+// VarFltst (no packed word), checked for add/sub/addsub only.
+// Work is sharded over classes (OpenMP), the first mismatch in sweep order is reported.
+// _ops: 'a' - all operators, 's' - addsub only (FpFmt23: other operators are the reference).
+
+#define VRF_NOPS 6	// fix2float, float2fix, add, sub, mult, addsub
+#define VRF_NONE 0x7FFFFFFFFFFFFFFFLL
+#define VRF_EXP0 (-32)	// exponents of classes: VRF_EXP0 .. 63
+#define VRF_NEXP (64 - VRF_EXP0)
+
+struct VrfBad
+{
+	long long idx;	// position in sweep, VRF_NONE - no mismatch
+	int aa;			// operands: int16 / fp23 word, scale
+	int bb;
+	VarFltst fa;	// operands of binary operators
+	VarFltst fb;
+	VarFltst ref;
+	VarFltst res;
+};
+
+static int vrf_same(VarFltst _aa, VarFltst _bb)
+{
+	return (_aa.sig == _bb.sig) && (_aa.ex == _bb.ex) && (_aa.man == _bb.man);
+}
+
+static VarFltst vrf_int(int _val)
+{
+	VarFltst fRes;
+	fRes.sig = 0;
+	fRes.ex = 0;
+	fRes.man = _val;
+	return fRes;
+}
+
+// keep mismatch with lowest sweep position
+static void vrf_put(VrfBad* _bad, long long _idx, int _aa, int _bb, VarFltst _fa, VarFltst _fb, VarFltst _ref, VarFltst _res)
+{
+	#pragma omp critical (vrf_bad)
+	{
+		if (_idx < _bad->idx)
+		{
+			_bad->idx = _idx;
+			_bad->aa = _aa;
+			_bad->bb = _bb;
+			_bad->fa = _fa;
+			_bad->fb = _fb;
+			_bad->ref = _ref;
+			_bad->res = _res;
+		}
+	}
+}
+
+// _type: 'i' - int16 -> fp23, 's' - fp23 -> int16 with scale, 'f' - fp23 x fp23
+static int vrf_report(const char* name, long long n_chk, const VrfBad* _bad, char _type)
+{
+	if (_bad->idx == VRF_NONE)
+	{
+		printf("  %-14s %12lld inputs: OK\n", name, n_chk);
+		return 0;
+	}
+	printf("  %-14s %12lld inputs: MISMATCH at %lld\n", name, n_chk, _bad->idx);
+	if (_type == 'i')
+		printf("    A = %d: ref = 0x%06X, res = 0x%06X\n", _bad->aa, _bad->ref.man, _bad->res.man);
+	else if (_type == 's')
+		printf("    A = 0x%06X, scale = %d: ref = %d, res = %d\n", _bad->aa, _bad->bb, _bad->ref.man, _bad->res.man);
+	else
+		printf("    A = {%d, %d, 0x%04X}, B = {%d, %d, 0x%04X}: ref = {%d, %d, 0x%04X}, res = {%d, %d, 0x%04X}\n",
+			_bad->fa.sig, _bad->fa.ex, _bad->fa.man, _bad->fb.sig, _bad->fb.ex, _bad->fb.man,
+			_bad->ref.sig, _bad->ref.ex, _bad->ref.man, _bad->res.sig, _bad->res.ex, _bad->res.man);
+	return 1;
+}
+
+template <class FP>
+int Verify_FP23(int _man_step, char _ops)
+{
+	if ((FP::EXP != 6) || (FP::MAN != 16) || (_man_step <= 0))
+		return -1;
+	VarFltst ZZ = {0, 0, 0};
+
+	VrfBad bad[VRF_NOPS];
+	for (int kk = 0; kk < VRF_NOPS; kk++)
+		bad[kk].idx = VRF_NONE;
+
+	int n_thr = 1;
+#ifdef _OPENMP
+	n_thr = omp_get_max_threads();
+#endif
+	printf("Verify fp23 operators (%s): %d shards, mantissa step 0x%X\n", (_ops == 's') ? "addsub" : "all", n_thr, _man_step);
+
+	// ---------------- FIX2FLOAT ---------------- //
+	#pragma omp parallel for
+	for (int ii = -0x8000; ii < 0x8000; ii++)
+	{
+		if (_ops == 's')
+			continue;
+		int ref = fix2float23(ii);
+		int res = FP::fix2float(ii);
+		if (ref != res)
+			vrf_put(&bad[0], ii + 0x8000, ii, 0, ZZ, ZZ, vrf_int(ref), vrf_int(res));
+	}
+
+	// ---------------- FLOAT2FIX ---------------- //
+	#pragma omp parallel for schedule(dynamic)
+	for (int sc = 0; sc < 64; sc++)
+	{
+		for (int ww = 0; (ww < (1 << 23)) && (_ops != 's'); ww++)
+		{
+			int ref = float2fix23(ww, sc);
+			int res = FP::float2fix(ww, sc);
+			if (ref != res)
+			{
+				vrf_put(&bad[1], ((long long)sc << 23) + ww, ww, sc, ZZ, ZZ, vrf_int(ref), vrf_int(res));
+				break;
+			}
+		}
+	}
+
+	// ---------------- BINARY OPERATORS ---------------- //
+	// mantissa set: step + edges (carry / rounding / MSB positions)
+	int* MM = (int*)malloc((0x10000 / _man_step + 8) * sizeof(int));
+	int nm = 0;
+	const int edge[] = {0x0001, 0x7FFF, 0x8000, 0xFFFE, 0xFFFF};
+	for (int mm = 0; mm < 0x10000; mm += _man_step)
+		MM[nm++] = mm;
+	for (int kk = 0; kk < 5; kk++)
+	{
+		int used = 0;
+		for (int jj = 0; jj < nm; jj++)
+			used |= (MM[jj] == edge[kk]);
+		if (used == 0)
+			MM[nm++] = edge[kk];
+	}
+
+	int n_cls = 4 * VRF_NEXP * VRF_NEXP;
+	long long n_pair = (long long)nm * nm;
+	long long n_mult = 0;
+	#pragma omp parallel for schedule(dynamic) reduction(+:n_mult)
+	for (int cls = 0; cls < n_cls; cls++)
+	{
+		int sa = (cls / (2 * VRF_NEXP * VRF_NEXP)) & 0x1;
+		int sb = (cls / (VRF_NEXP * VRF_NEXP)) & 0x1;
+		int ea = (cls / VRF_NEXP) % VRF_NEXP + VRF_EXP0;
+		int eb = (cls % VRF_NEXP) + VRF_EXP0;
+		long long idx0 = cls * n_pair;
+
+		// mismatches found in class: bits of add, sub, mult, addsub (set - not checked)
+		int found = (_ops == 's') ? 0x7 : 0;
+		if ((ea < 0) || (eb < 0))
+			found |= 0x4;
+		else
+			n_mult += n_pair;
+		for (int ia = 0; (ia < nm) && (found != 0xF); ia++)
+		{
+			for (int ib = 0; (ib < nm) && (found != 0xF); ib++)
+			{
+				long long idx = idx0 + (long long)ia * nm + ib;
+				VarFltst AA = {sa, ea, MM[ia]};
+				VarFltst BB = {sb, eb, MM[ib]};
+
+				VarFltst ref[4], res[4];
+				ref[0] = float_add23(AA, BB, 'a');
+				ref[1] = float_add23(AA, BB, 's');
+				ref[2] = float_mult23(AA, BB);
+				res[0] = FP::add(AA, BB, 'a');
+				res[1] = FP::add(AA, BB, 's');
+				res[2] = FP::mult(AA, BB);
+
+				VarFltst res_dif;
+				FP::addsub(AA, BB, &res[3], &res_dif);
+				ref[3] = ref[0];
+				if (vrf_same(ref[0], res[3]))
+				{
+					ref[3] = ref[1];
+					res[3] = res_dif;
+				}
+
+				for (int kk = 0; kk < 4; kk++)
+				{
+					if (((found >> kk) & 0x1) || vrf_same(ref[kk], res[kk]))
+						continue;
+					vrf_put(&bad[2 + kk], idx, 0, 0, AA, BB, ref[kk], res[kk]);
+					found |= (1 << kk);
+				}
+			}
+		}
+	}
+	free(MM);
+
+	int n_bad = 0;
+	if (_ops != 's')
+	{
+		n_bad += vrf_report("fix2float23", 0x10000LL, &bad[0], 'i');
+		n_bad += vrf_report("float2fix23", 64LL << 23, &bad[1], 's');
+		n_bad += vrf_report("float_add23", n_cls * n_pair, &bad[2], 'f');
+		n_bad += vrf_report("float_sub23", n_cls * n_pair, &bad[3], 'f');
+		n_bad += vrf_report("float_mult23", n_mult, &bad[4], 'f');
+	}
+	n_bad += vrf_report("float_addsub23", n_cls * n_pair, &bad[5], 'f');
+	return n_bad;
+}
+
+template int Verify_FP23<FpGeneric<6, 16> >(int _man_step, char _ops);
+template int Verify_FP23<FpFmt23>(int _man_step, char _ops);
@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <math.h>
+#include <cstdlib>
+
+#include "fp_fmt.h"
+
+// Bessel I0 for Kaiser window
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (int k = 1; k < 64; k++)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-17)
+			break;
+	}
+	return sum;
+}
+
+template <class FP>
+void Window_WW(int _nFFT, VarFltst* _win, char _type, double _beta, const double* _user)
+{
+	for (int ii = 0; ii < _nFFT; ii++)
+	{
+		double phi = (2.0 * pi * ii) / _nFFT;
+		double ww = 1.0;
+		if (_type == 'h')
+			ww = 0.5 - 0.5 * cos(phi);
+		else if (_type == 'b')
+			ww = 0.42 - 0.5 * cos(phi) + 0.08 * cos(2.0 * phi);
+		else if (_type == 'k')
+		{
+			double xx = (2.0 * ii) / _nFFT - 1.0;
+			ww = bessel_i0(_beta * sqrt(1.0 - xx * xx)) / bessel_i0(_beta);
+		}
+		else if (_type == 'u')
+			ww = _user[ii];
+		else if (_type != 'r')
+		{
+			printf("Incorrect window type!\n");
+			return;
+		}
+
+		// ROM coeffs as hardware window: coef2float(TW_MAX * w), int16 for fp23
+		int ww_int = (int)floor(FP::TW_MAX * ww + 0.5);
+		_win[ii] = FP::expand(FP::coef2float(ww_int));
+	}
+}
+
+template <class FP>
+void FLOAT_INPUT(const FftPlan* plan, const int* _din_re, const int* _din_im, const VarFltst* _win, ComplexVarFltst* _AF)
+{
+	int nFFT = plan->n_fft;
+	PROF_BEGIN();
+	for (int ii = 0; ii < nFFT; ii++)
+	{
+		// zero region of pruned plan: zeros are written by FLOAT_FFT
+		if ((ii >= plan->z0) && (ii < plan->z1))
+			continue;
+		// DIF - natural order, DIT - bit-reversed order
+		int jj = (plan->_inv == 'f') ? ii : plan->rev[ii];
+
+		VarFltst Xre = FP::expand(FP::fix2float(_din_re[ii]));
+		VarFltst Xim = FP::expand(FP::fix2float(_din_im[ii]));
+		if (_win != NULL)
+		{
+			Xre = FP::mult(Xre, _win[ii]);
+			Xim = FP::mult(Xim, _win[ii]);
+		}
+		_AF[jj].re = Xre;
+		_AF[jj].im = Xim;
+	}
+	PROF_END("fix2float", 0);
+}
+
+#define INST_WIN(FP) \
+	template void Window_WW<FP>(int _nFFT, VarFltst* _win, char _type, double _beta, const double* _user); \
+	template void FLOAT_INPUT<FP>(const FftPlan* plan, const int* _din_re, const int* _din_im, const VarFltst* _win, ComplexVarFltst* _AF);
+FP_FORMATS(INST_WIN)
@@ -0,0 +1,536 @@
+// fp23fft: Python module over fp23 FFT engine
+//
+// All data are packed words in caller buffers (buffer protocol, no copies):
+//   int16 - int16 samples {re, im, re, im, ...}
+//   fp23  - int32 fp23 words {re, im, re, im, ...}, frames of NFFT complex
+// FFT output / IFFT input is bit-reversed (see Plan.rev), as in hardware.
+// GIL is released while computing, frames of a batch run in parallel (OpenMP).
+//
+//   import fp23fft
+//   pf = fp23fft.Plan(1024, 'f')          # 'f' - FFT, 'i' - IFFT; twiddle='r' (ROM) / 'f' (file),
+//                                         # radix=2 (bit-exact) / 4 (radix-2^2 analysis)
+//   fp23fft.fix2float(x16, x23)           # int16 -> fp23
+//   ex = pf.execute(x23)                  # batch FFT in place, returns max exponent
+//   sc = fp23fft.float2fix(x23, y16, -1)  # fp23 -> int16, -1: auto scale (BFP)
+//   fp23fft.fconv(pf, pi, x23, sf)        # fast convolution, sf - spectrum (bit-reversed)
+//   fp23fft.fconv(pf, pi, x23, sf, 'rc')  # same, frames cached in directory 'rc' (see fp_cache.cpp)
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "stdafx.h"
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "fp_fmt.h"
+
+typedef FpFmt23 FpPy;
+
+// ---------------- buffers ---------------- //
+static int buf_get(PyObject* _obj, Py_buffer* _view, int _itemsize, int _write, const char* _name)
+{
+	int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (_write ? PyBUF_WRITABLE : 0);
+	if (PyObject_GetBuffer(_obj, _view, flags) < 0)
+		return -1;
+	if (_view->itemsize != _itemsize)
+	{
+		PyErr_Format(PyExc_TypeError, "%s: expected %d-byte items, got %d", _name, _itemsize, (int)_view->itemsize);
+		PyBuffer_Release(_view);
+		return -1;
+	}
+	// item type: 4 - signed int32 (fp23 words), 2 - int16, 1 - mask bytes
+	const char* fmt = (_view->format != NULL) ? _view->format : "B";
+	const char* fmt_in = fmt;
+	if ((fmt[0] == '@') || (fmt[0] == '=') || ((fmt[0] == '<') && (PY_LITTLE_ENDIAN)))
+		fmt++;
+	const char* ok = (_itemsize == 4) ? "il" : ((_itemsize == 2) ? "h" : "bB?");
+	if ((fmt[0] == 0) || (fmt[1] != 0) || (strchr(ok, fmt[0]) == NULL))
+	{
+		PyErr_Format(PyExc_TypeError, "%s: expected item format '%s', got '%s'", _name,
+			(_itemsize == 4) ? "i" : ((_itemsize == 2) ? "h" : "B"), fmt_in);
+		PyBuffer_Release(_view);
+		return -1;
+	}
+	return 0;
+}
+
+static int frames_of(Py_buffer* _view, int _nFFT, const char* _name)
+{
+	Py_ssize_t nw = _view->len / 4;
+	if ((nw == 0) || (nw % (2 * (Py_ssize_t)_nFFT) != 0))
+	{
+		PyErr_Format(PyExc_ValueError, "%s: length must be a multiple of 2*NFFT words", _name);
+		return -1;
+	}
+	return (int)(nw / (2 * _nFFT));
+}
+
+static int n_threads(int _frames)
+{
+	int n_par = 1;
+#ifdef _OPENMP
+	n_par = omp_get_max_threads();
+#endif
+	return (n_par > _frames) ? _frames : n_par;
+}
+
+static int thread_id()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+// ---------------- plan ---------------- //
+// Plan is read by transforms without GIL: busy - running execute / fconv,
+// exports - views of rev; plan is not changed (re-init, pruning) while used
+typedef struct {
+	PyObject_HEAD
+	FftPlan plan;
+	int busy;
+	int exports;
+} PlanObject;
+
+static int plan_free(PlanObject* self, const char* _name)
+{
+	if ((self->busy == 0) && (self->exports == 0))
+		return 0;
+	PyErr_Format(PyExc_RuntimeError, "%s: plan is in use (%s)", _name,
+		(self->busy != 0) ? "transform is running" : "rev is exported");
+	return -1;
+}
+
+// Plan() failed or __init__ was not called (tp_new only): no tables
+static int plan_ready(PlanObject* self, const char* _name)
+{
+	if (self->plan.ww != NULL)
+		return 0;
+	PyErr_Format(PyExc_RuntimeError, "%s: plan is not initialized", _name);
+	return -1;
+}
+
+static int Plan_init(PlanObject* self, PyObject* args, PyObject* kwds)
+{
+	static const char* kwlist[] = {"nfft", "direction", "twiddle", "radix", NULL};
+	int nFFT;
+	const char* dir = "f";
+	const char* tw = "r";
+	int radix = 2;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|ssi", (char**)kwlist, &nFFT, &dir, &tw, &radix))
+		return -1;
+	if ((nFFT < 8) || (nFFT > 262144) || (nFFT & (nFFT - 1)))
+	{
+		PyErr_SetString(PyExc_ValueError, "nfft: power of 2 from 8 to 262144");
+		return -1;
+	}
+	if (((dir[0] != 'f') && (dir[0] != 'i')) || ((tw[0] != 'r') && (tw[0] != 'f')))
+	{
+		PyErr_SetString(PyExc_ValueError, "direction: 'f' / 'i', twiddle: 'r' / 'f'");
+		return -1;
+	}
+	if ((radix != 2) && (radix != 4))
+	{
+		PyErr_SetString(PyExc_ValueError, "radix: 2 (bit-exact) / 4 (radix-2^2 analysis)");
+		return -1;
+	}
+	if (plan_free(self, "Plan") < 0)
+		return -1;
+	Free_FFT(&self->plan);
+	self->plan = Plan_FFT<FpPy>(nFFT, dir[0], tw[0]);
+	if (self->plan.ww == NULL)
+	{
+		Free_FFT(&self->plan);
+		PyErr_Format(PyExc_OSError, "Plan: cannot read twiddle file for NFFT %d (use twiddle='r')", nFFT);
+		return -1;
+	}
+	self->plan._rdx = (radix == 4) ? '4' : '2';
+	return 0;
+}
+
+static void Plan_dealloc(PlanObject* self)
+{
+	Free_FFT(&self->plan);
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject* Plan_execute(PlanObject* self, PyObject* args)
+{
+	PyObject* obj;
+	if (!PyArg_ParseTuple(args, "O", &obj))
+		return NULL;
+	if (plan_ready(self, "execute") < 0)
+		return NULL;
+	Py_buffer bx;
+	if (buf_get(obj, &bx, 4, 1, "execute") < 0)
+		return NULL;
+
+	int nFFT = self->plan.n_fft;
+	int n_frm = frames_of(&bx, nFFT, "execute");
+	if (n_frm < 0)
+	{
+		PyBuffer_Release(&bx);
+		return NULL;
+	}
+	int* Dx = (int*)bx.buf;
+	int exmax = 0;
+
+	self->busy++;
+	Py_BEGIN_ALLOW_THREADS
+	int n_par = n_threads(n_frm);
+	ComplexVarFltst* Sx = (ComplexVarFltst*)malloc((size_t)n_par * nFFT * sizeof(ComplexVarFltst));
+	#pragma omp parallel for num_threads(n_par)
+	for (int ff = 0; ff < n_frm; ff++)
+	{
+		ComplexVarFltst* Fx = Sx + (size_t)thread_id() * nFFT;
+		int* Wx = Dx + (size_t)ff * 2 * nFFT;
+		for (int ii = 0; ii < nFFT; ii++)
+		{
+			Fx[ii].re = FpPy::expand(Wx[2*ii+0]);
+			Fx[ii].im = FpPy::expand(Wx[2*ii+1]);
+		}
+		int ex = FLOAT_FFT<FpPy>(&self->plan, Fx);
+		for (int ii = 0; ii < nFFT; ii++)
+		{
+			Wx[2*ii+0] = FpPy::collapse(Fx[ii].re);
+			Wx[2*ii+1] = FpPy::collapse(Fx[ii].im);
+		}
+		#pragma omp critical
+		{
+			if (ex > exmax)
+				exmax = ex;
+		}
+	}
+	free(Sx);
+	Py_END_ALLOW_THREADS
+	self->busy--;
+
+	PyBuffer_Release(&bx);
+	return PyLong_FromLong(exmax);
+}
+
+static PyObject* Plan_prune_out(PlanObject* self, PyObject* args)
+{
+	PyObject* obj;
+	if (!PyArg_ParseTuple(args, "O", &obj))
+		return NULL;
+	if ((plan_ready(self, "prune_out") < 0) || (plan_free(self, "prune_out") < 0))
+		return NULL;
+	Py_buffer bm;
+	if (buf_get(obj, &bm, 1, 0, "prune_out") < 0)
+		return NULL;
+	if (bm.len != self->plan.n_fft)
+	{
+		PyBuffer_Release(&bm);
+		PyErr_SetString(PyExc_ValueError, "prune_out: mask must have NFFT bytes");
+		return NULL;
+	}
+	int n_use = Prune_Out(&self->plan, (const char*)bm.buf);
+	PyBuffer_Release(&bm);
+	return PyLong_FromLong(n_use);
+}
+
+static PyObject* Plan_prune_in(PlanObject* self, PyObject* args)
+{
+	int z0, z1;
+	if (!PyArg_ParseTuple(args, "ii", &z0, &z1))
+		return NULL;
+	if ((plan_ready(self, "prune_in") < 0) || (plan_free(self, "prune_in") < 0))
+		return NULL;
+	return PyLong_FromLong(Prune_In(&self->plan, z0, z1));
+}
+
+static PyObject* Plan_prune_reset(PlanObject* self, PyObject* args)
+{
+	if ((plan_ready(self, "prune_reset") < 0) || (plan_free(self, "prune_reset") < 0))
+		return NULL;
+	Prune_Reset(&self->plan);
+	Py_RETURN_NONE;
+}
+
+// Plan exports bit-reverse table as read-only bytes, Plan.rev casts it to int32
+static int Plan_getbuffer(PlanObject* self, Py_buffer* view, int flags)
+{
+	if (plan_ready(self, "rev") < 0)
+		return -1;
+	if (PyBuffer_FillInfo(view, (PyObject*)self, self->plan.rev,
+		(Py_ssize_t)self->plan.n_fft * sizeof(int), 1, flags) < 0)
+		return -1;
+	self->exports++;
+	return 0;
+}
+
+static void Plan_releasebuffer(PlanObject* self, Py_buffer* view)
+{
+	self->exports--;
+}
+
+static PyObject* Plan_rev(PlanObject* self, void* closure)
+{
+	PyObject* mv = PyMemoryView_FromObject((PyObject*)self);
+	if (mv == NULL)
+		return NULL;
+	PyObject* rev = PyObject_CallMethod(mv, "cast", "s", "i");
+	Py_DECREF(mv);
+	return rev;
+}
+
+static PyObject* Plan_nfft(PlanObject* self, void* closure)
+{
+	return PyLong_FromLong(self->plan.n_fft);
+}
+
+static PyObject* Plan_direction(PlanObject* self, void* closure)
+{
+	return PyUnicode_FromStringAndSize(&self->plan._inv, 1);
+}
+
+static PyMethodDef Plan_methods[] = {
+	{"execute", (PyCFunction)Plan_execute, METH_VARARGS, "execute(buf): batch FFT/IFFT in place on fp23 frames, returns max exponent"},
+	{"prune_out", (PyCFunction)Plan_prune_out, METH_VARARGS, "prune_out(mask): calculate only bins with mask[bin] != 0 (NFFT bytes), replaces previous mask, returns number of butterflies"},
+	{"prune_in", (PyCFunction)Plan_prune_in, METH_VARARGS, "prune_in(z0, z1): input points [z0, z1) are zero (not read), replaces previous region, returns number of full butterflies"},
+	{"prune_reset", (PyCFunction)Plan_prune_reset, METH_NOARGS, "prune_reset(): full FFT again"},
+	{NULL}
+};
+
+static PyGetSetDef Plan_getset[] = {
+	{"rev", (getter)Plan_rev, NULL, "bit-reverse table (read-only int32 view)", NULL},
+	{"nfft", (getter)Plan_nfft, NULL, "FFT length", NULL},
+	{"direction", (getter)Plan_direction, NULL, "'f' - FFT, 'i' - IFFT", NULL},
+	{NULL}
+};
+
+static PyBufferProcs Plan_as_buffer = { (getbufferproc)Plan_getbuffer, (releasebufferproc)Plan_releasebuffer };
+
+static PyTypeObject PlanType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+// ---------------- conversions ---------------- //
+static PyObject* py_fix2float(PyObject* mod, PyObject* args)
+{
+	PyObject *src, *dst;
+	if (!PyArg_ParseTuple(args, "OO", &src, &dst))
+		return NULL;
+	Py_buffer bs, bd;
+	if (buf_get(src, &bs, 2, 0, "fix2float: src") < 0)
+		return NULL;
+	if (buf_get(dst, &bd, 4, 1, "fix2float: dst") < 0)
+	{
+		PyBuffer_Release(&bs);
+		return NULL;
+	}
+	Py_ssize_t nn = bs.len / 2;
+	if (bd.len / 4 != nn)
+	{
+		PyBuffer_Release(&bs);
+		PyBuffer_Release(&bd);
+		PyErr_SetString(PyExc_ValueError, "fix2float: src and dst lengths differ");
+		return NULL;
+	}
+	const short* Sx = (const short*)bs.buf;
+	int* Dx = (int*)bd.buf;
+
+	Py_BEGIN_ALLOW_THREADS
+	#pragma omp parallel for
+	for (long long ii = 0; ii < (long long)nn; ii++)
+		Dx[ii] = FpPy::fix2float(Sx[ii]);
+	Py_END_ALLOW_THREADS
+
+	PyBuffer_Release(&bs);
+	PyBuffer_Release(&bd);
+	Py_RETURN_NONE;
+}
+
+static PyObject* py_float2fix(PyObject* mod, PyObject* args)
+{
+	PyObject *src, *dst;
+	int _scale = SCALE;
+	if (!PyArg_ParseTuple(args, "OO|i", &src, &dst, &_scale))
+		return NULL;
+	Py_buffer bs, bd;
+	if (buf_get(src, &bs, 4, 0, "float2fix: src") < 0)
+		return NULL;
+	if (buf_get(dst, &bd, 2, 1, "float2fix: dst") < 0)
+	{
+		PyBuffer_Release(&bs);
+		return NULL;
+	}
+	Py_ssize_t nn = bs.len / 4;
+	if (bd.len / 2 != nn)
+	{
+		PyBuffer_Release(&bs);
+		PyBuffer_Release(&bd);
+		PyErr_SetString(PyExc_ValueError, "float2fix: src and dst lengths differ");
+		return NULL;
+	}
+	const int* Sx = (const int*)bs.buf;
+	short* Dx = (short*)bd.buf;
+
+	Py_BEGIN_ALLOW_THREADS
+	// scale < 0: auto scale (BFP) for whole buffer
+	if (_scale < 0)
+	{
+		int exmax = 0;
+		for (Py_ssize_t ii = 0; ii < nn; ii++)
+		{
+			int ex = FpPy::exp_of(FpPy::expand(Sx[ii]));
+			if (ex > exmax)
+				exmax = ex;
+		}
+		_scale = Scale_BFP<FpPy>(exmax);
+	}
+	#pragma omp parallel for
+	for (long long ii = 0; ii < (long long)nn; ii++)
+		Dx[ii] = (short)FpPy::float2fix(Sx[ii], _scale);
+	Py_END_ALLOW_THREADS
+
+	PyBuffer_Release(&bs);
+	PyBuffer_Release(&bd);
+	return PyLong_FromLong(_scale);
+}
+
+// ---------------- fast convolution ---------------- //
+static PyObject* py_fconv(PyObject* mod, PyObject* args)
+{
+	PlanObject *pl_f, *pl_i;
+	PyObject *obj, *sf;
+	const char* cache = NULL;
+	if (!PyArg_ParseTuple(args, "O!O!OO|z", &PlanType, &pl_f, &PlanType, &pl_i, &obj, &sf, &cache))
+		return NULL;
+	if ((plan_ready(pl_f, "fconv") < 0) || (plan_ready(pl_i, "fconv") < 0))
+		return NULL;
+	if ((pl_f->plan._inv != 'f') || (pl_i->plan._inv != 'i') || (pl_f->plan.n_fft != pl_i->plan.n_fft))
+	{
+		PyErr_SetString(PyExc_ValueError, "fconv: need FFT and IFFT plans of one length");
+		return NULL;
+	}
+	int nFFT = pl_f->plan.n_fft;
+	Py_buffer bx, bs;
+	if (buf_get(obj, &bx, 4, 1, "fconv: buf") < 0)
+		return NULL;
+	if (buf_get(sf, &bs, 4, 0, "fconv: sf") < 0)
+	{
+		PyBuffer_Release(&bx);
+		return NULL;
+	}
+	int n_frm = frames_of(&bx, nFFT, "fconv: buf");
+	if ((n_frm >= 0) && (bs.len / 4 != 2 * (Py_ssize_t)nFFT))
+	{
+		PyErr_SetString(PyExc_ValueError, "fconv: sf must have NFFT complex words");
+		n_frm = -1;
+	}
+	if (n_frm < 0)
+	{
+		PyBuffer_Release(&bx);
+		PyBuffer_Release(&bs);
+		return NULL;
+	}
+	int* Dx = (int*)bx.buf;
+	const int* Wf = (const int*)bs.buf;
+	int exmax = 0;
+	if ((cache != NULL) && (cache[0] == 0))
+		cache = NULL;
+
+	pl_f->busy++;
+	pl_i->busy++;
+	Py_BEGIN_ALLOW_THREADS
+	// cache key of frame: sf, plans, frame words
+	unsigned long long hs = Cache_Hash(CACHE_SEED, Wf, 2 * nFFT * sizeof(int));
+	hs = Cache_Key<FpPy>(hs, &pl_f->plan, 'v', 0);
+	hs = Cache_Key<FpPy>(hs, &pl_i->plan, 'n', 0);
+	int n_par = n_threads(n_frm);
+	ComplexVarFltst* SF = (ComplexVarFltst*)malloc((size_t)nFFT * sizeof(ComplexVarFltst));
+	ComplexVarFltst* Sx = (ComplexVarFltst*)malloc((size_t)n_par * nFFT * sizeof(ComplexVarFltst));
+	for (int ii = 0; ii < nFFT; ii++)
+	{
+		SF[ii].re = FpPy::expand(Wf[2*ii+0]);
+		SF[ii].im = FpPy::expand(Wf[2*ii+1]);
+	}
+	#pragma omp parallel for num_threads(n_par)
+	for (int ff = 0; ff < n_frm; ff++)
+	{
+		ComplexVarFltst* Fx = Sx + (size_t)thread_id() * nFFT;
+		int* Wx = Dx + (size_t)ff * 2 * nFFT;
+		unsigned long long key = 0;
+		int ex = 0;
+		if (cache != NULL)
+		{
+			key = Cache_Hash(hs, Wx, 2 * nFFT * sizeof(int));
+			if (Cache_Get(cache, key, 'p', Wx, 2 * nFFT, &ex) == 0)
+			{
+				#pragma omp critical
+				{
+					if (ex > exmax)
+						exmax = ex;
+				}
+				continue;
+			}
+		}
+		for (int ii = 0; ii < nFFT; ii++)
+		{
+			Fx[ii].re = FpPy::expand(Wx[2*ii+0]);
+			Fx[ii].im = FpPy::expand(Wx[2*ii+1]);
+		}
+		ex = FLOAT_FCONV<FpPy>(&pl_f->plan, &pl_i->plan, Fx, SF);
+		for (int ii = 0; ii < nFFT; ii++)
+		{
+			Wx[2*ii+0] = FpPy::collapse(Fx[ii].re);
+			Wx[2*ii+1] = FpPy::collapse(Fx[ii].im);
+		}
+		if (cache != NULL)
+			Cache_Put(cache, key, 'p', Wx, 2 * nFFT, ex);
+		#pragma omp critical
+		{
+			if (ex > exmax)
+				exmax = ex;
+		}
+	}
+	free(Sx);
+	free(SF);
+	Py_END_ALLOW_THREADS
+	pl_f->busy--;
+	pl_i->busy--;
+
+	PyBuffer_Release(&bx);
+	PyBuffer_Release(&bs);
+	return PyLong_FromLong(exmax);
+}
+
+// ---------------- module ---------------- //
+static PyMethodDef fp23fft_methods[] = {
+	{"fix2float", py_fix2float, METH_VARARGS, "fix2float(src_int16, dst_fp23): int16 -> fp23"},
+	{"float2fix", py_float2fix, METH_VARARGS, "float2fix(src_fp23, dst_int16, scale=SCALE): fp23 -> int16, scale < 0 - auto (BFP), returns scale"},
+	{"fconv", py_fconv, METH_VARARGS, "fconv(plan_f, plan_i, buf, sf, cache=None): fast convolution in place, returns max exponent; cache - result cache directory"},
+	{NULL}
+};
+
+static struct PyModuleDef fp23fft_module = {
+	PyModuleDef_HEAD_INIT, "fp23fft", "fp23 FFT engine over packed buffers", -1, fp23fft_methods
+};
+
+PyMODINIT_FUNC PyInit_fp23fft(void)
+{
+	PlanType.tp_name = "fp23fft.Plan";
+	PlanType.tp_basicsize = sizeof(PlanObject);
+	PlanType.tp_flags = Py_TPFLAGS_DEFAULT;
+	PlanType.tp_doc = "Plan(nfft, direction='f', twiddle='r', radix=2): fp23 FFT plan";
+	PlanType.tp_new = PyType_GenericNew;
+	PlanType.tp_init = (initproc)Plan_init;
+	PlanType.tp_dealloc = (destructor)Plan_dealloc;
+	PlanType.tp_methods = Plan_methods;
+	PlanType.tp_getset = Plan_getset;
+	PlanType.tp_as_buffer = &Plan_as_buffer;
+	if (PyType_Ready(&PlanType) < 0)
+		return NULL;
+
+	PyObject* mod = PyModule_Create(&fp23fft_module);
+	if (mod == NULL)
+		return NULL;
+	Py_INCREF(&PlanType);
+	PyModule_AddObject(mod, "Plan", (PyObject*)&PlanType);
+	PyModule_AddIntConstant(mod, "SCALE", SCALE);
+	return mod;
+}
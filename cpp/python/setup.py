@@ -0,0 +1,22 @@
+# fp23fft: Python module over fp23 FFT engine (../fp_*.cpp)
+#
+#   python setup.py build_ext --inplace
+#
+import sys
+from setuptools import setup, Extension
+
+src = ['fp23fft.cpp'] + ['../' + ff for ff in [
+	'fp_op.cpp', 'fp_reverse.cpp', 'fp_butterfly.cpp', 'fp_fft.cpp', 'fp_fconv.cpp',
+	'fp_window.cpp', 'fp_scale.cpp', 'fp_stft.cpp', 'fp_prof.cpp', 'fp_verify.cpp', 'fp_radix4.cpp', 'fp_prune.cpp', 'fp_batch.cpp', 'fp_cache.cpp']]
+
+if sys.platform == 'win32':
+	cflags, lflags = ['/O2', '/openmp'], []
+else:
+	cflags, lflags = ['-O2', '-fopenmp'], ['-fopenmp']
+
+setup(
+	name='fp23fft',
+	version='1.0',
+	ext_modules=[Extension('fp23fft', src, include_dirs=['.', '..'],
+		extra_compile_args=cflags, extra_link_args=lflags, language='c++')],
+)
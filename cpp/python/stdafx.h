@@ -0,0 +1,14 @@
+// stdafx.h for non-MSVC builds of the engine sources (Python module, fp_conv on POSIX)
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_MSC_VER)
+static inline char* itoa(int _val, char* _str, int _radix)
+{
+	(void)_radix;
+	sprintf(_str, "%d", _val);
+	return _str;
+}
+#endif